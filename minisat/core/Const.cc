@@ -1,16 +1,29 @@
+#include <mutex>
+
 #include "minisat/core/Const.h"
 
 const float Hyper_Const::c_act = 0.05854f;    // need a better value here for exploration
+const float Hyper_Const::virtual_loss = 1.0f;  // the lowest value of a state
 const int Hyper_Const::MCTS_size_lim = 100; // the size of MCT we want to achieve.
 
 const gsl_rng* Hyper_Const::r = gsl_rng_alloc(gsl_rng_mt19937);
 
 //const double Hyper_Const::alpha[Hyper_Const::nact] = {0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3,0.3};
 
-const double Hyper_Const::alpha[Hyper_Const::nact] = {2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0,2.0};
+const double Hyper_Const::alpha = 2.0;
+
+static std::mutex lock; // (r is shared by the Solvers of all threads)
 
-void Hyper_Const::generate_dirichlet(double* di) {
-    gsl_ran_dirichlet(Hyper_Const::r, Hyper_Const::nact, Hyper_Const::alpha, di);
+void Hyper_Const::generate_dirichlet(double* di, int n) {
+    double alphas[Hyper_Const::max_nact];
+    for (int i = 0; i < n; i++) alphas[i] = Hyper_Const::alpha;
+    std::lock_guard<std::mutex> guard(lock);
+    gsl_ran_dirichlet(Hyper_Const::r, n, alphas, di);
 } 
+
+void Hyper_Const::seed_dirichlet(unsigned long seed) {
+    std::lock_guard<std::mutex> guard(lock);
+    gsl_rng_set(Hyper_Const::r, seed);
+}
 //const float Hyper_Const::c_act = 6.095f;      // need a better value here for exploration
 //const int Hyper_Const::MCTS_size_lim = 487; // the size of MCT we want to achieve.
@@ -9,16 +9,19 @@
 class Hyper_Const
 {
 public :
-    static const int dim0 = 120;           // max_clause
-    static const int dim1 = 20;            // max_var
+    static const int dim0 = 120;           // max_clause (default, each Solver has its own, see state_dims)
+    static const int dim1 = 20;            // max_var    (default, each Solver has its own, see state_dims)
     static const int dim2 = 2;             // nc
-    static const int nact = 40;            // nact 
+    static const int nact = 40;            // nact       (default, 2 * dim1)
+    static const int max_nact = 256;       // the largest number of actions of a Solver (max_var up to 128)
     static const float c_act;     	       // c_act is a hyperparameter for MCTS (decide the level of exploration) 
+    static const float virtual_loss;       // the value a waiting leaf counts as on its path, in batched MCTS (see mcts_node::vloss)
 
     static const gsl_rng *r;              // random generater
-    static const double alpha[nact];      // alpha parameter
-    static void generate_dirichlet(double*);     // function used to generate dirichlet noise
-    static const int MCTS_size_lim; // the size of MCT we want to achieve.
+    static const double alpha;            // alpha parameter (the same for all actions)
+    static void generate_dirichlet(double*, int n);  // function used to generate dirichlet noise (of n actions)
+    static void seed_dirichlet(unsigned long seed);  // reseed r: the noise drawn after it is the same for the same seed
+    static const int MCTS_size_lim; // the size of MCT we want to achieve (default, each Solver has its own).
 };
 
 #endif
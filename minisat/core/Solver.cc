@@ -25,6 +25,12 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "minisat/utils/System.h"
 #include "minisat/core/Solver.h"
 #include "minisat/core/shadow.h"
+#include "minisat/core/replay.h"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 using namespace Minisat;
 
@@ -46,6 +52,10 @@ static IntOption     opt_restart_first     (_cat, "rfirst",      "The base resta
 static DoubleOption  opt_restart_inc       (_cat, "rinc",        "Restart interval increase factor", 2, DoubleRange(1, false, HUGE_VAL, false));
 static DoubleOption  opt_garbage_frac      (_cat, "gc-frac",     "The fraction of wasted memory allowed before a garbage collection is triggered",  0.20, DoubleRange(0, false, HUGE_VAL, false));
 static IntOption     opt_min_learnts_lim   (_cat, "min-learnts", "Minimum learnt clause limit",  0, IntRange(0, INT32_MAX));
+static BoolOption    opt_mcts_replay       (_cat, "mcts-replay", "Run MCTS simulations on the solver itself (undone after each simulation) instead of shadow copies", false);
+static IntOption     opt_mcts_threads      (_cat, "mcts-threads","Number of threads that collect one batch of MCTS leaves (shadow copies only)", 1, IntRange(1, INT32_MAX));
+static IntOption     opt_mcts_trees        (_cat, "mcts-trees",  "Number of independent MCTS trees searched at once, one thread each (shadow copies only)", 1, IntRange(1, INT32_MAX));
+static BoolOption    opt_mcts_transpose    (_cat, "mcts-transpose","Give a new MCTS leaf the evaluation of a shadow in the same state, if there is one (shadow copies only)", true);
 
 
 //=================================================================================================
@@ -80,9 +90,27 @@ Solver::Solver() :
   , learntsize_adjust_start_confl (100)
   , learntsize_adjust_inc         (1.5)
 
+    // Gym environment (nothing written and nothing on hold until the first search):
+    //
+  , write_state_to   ()
+  , state_key        (0)
+  , snapTo           (NULL)
+  , env_hold         (false)
+  , env_reward       (0)
+  , env_state        (NULL)
+  , env_state_size   (0)
+
     // for shadows
   , root_shadow (NULL)
-  , leaf_shadow (NULL)  
+  , mcts_replay (opt_mcts_replay)
+  , mcts_size_lim (Hyper_Const::MCTS_size_lim)
+  , mcts_threads (opt_mcts_threads)
+  , mcts_trees (opt_mcts_trees)
+  , mcts_transpose (opt_mcts_transpose)
+  , nn_cache (NULL)
+  , nn_net (NULL)
+  , mcts_evaluator (eval_none)
+  , root_replay (NULL)
 
     // Statistics: (formerly in 'SolverStats')
     //
@@ -90,6 +118,8 @@ Solver::Solver() :
   , dec_vars(0), num_clauses(0), num_learnts(0), clauses_literals(0), learnts_literals(0), max_literals(0), tot_literals(0)
 
   , watches            (WatcherDeleted(ca))
+  , lit_occurs         (ClauseDeleted(ca))
+  , num_unsat          (0)
   , order_heap         (VarOrderLt(activity))
   , ok                 (true)
   , cla_inc            (1)
@@ -106,11 +136,26 @@ Solver::Solver() :
   , conflict_budget    (-1)
   , propagation_budget (-1)
   , asynch_interrupt   (false)
+  , mcts_time_budget   (-1)
+  , mcts_prop_budget   (-1)
+  , mcts_mem_budget    (-1)
+  , mcts_deadline      (-1)
+  , mcts_prop_target   (-1)
+  , mcts_propagations  (0)
+  , shadow_bytes       (0)
+  , replaying          (false)
 {}
 
 
 Solver::~Solver()
 {
+    // release the tree of shadows before the shadow pool and the shadow arena are destructed
+    reclaim_memory(root_shadow);
+    for (int i = 0; i < root_ensemble.size(); i++)
+        reclaim_memory(root_ensemble[i]);
+    shadow_nodes.clear();
+    replay_nodes.discard(root_replay);
+    replay_nodes.clear();
     // Comments by Fei: added to generate states for gym environment.
     if (env_state_size > 0) {
         delete[] env_state;
@@ -138,6 +183,8 @@ Var Solver::newVar(lbool upol, bool dvar)
 
     watches  .init(mkLit(v, false));
     watches  .init(mkLit(v, true ));
+    lit_occurs.init(mkLit(v, false));
+    lit_occurs.init(mkLit(v, true ));
     assigns  .insert(v, l_Undef);
     vardata  .insert(v, mkVarData(CRef_Undef, 0));
     activity .insert(v, rnd_init_act ? drand(random_seed) * 0.00001 : 0);
@@ -193,12 +240,19 @@ bool Solver::addClause_(vec<Lit>& ps)
 
 
 void Solver::attachClause(CRef cr){
-    const Clause& c = ca[cr];
+    Clause& c = ca[cr];
     assert(c.size() > 1);
     watches[~c[0]].push(Watcher(cr, c[1]));
     watches[~c[1]].push(Watcher(cr, c[0]));
     if (c.learnt()) num_learnts++, learnts_literals += c.size();
     else            num_clauses++, clauses_literals += c.size();
+
+    // Start counting the true literals of the clause:
+    c.satCount() = 0;
+    for (int i = 0; i < c.size(); i++){
+        lit_occurs[c[i]].push(cr);
+        if (value(c[i]) == l_True) c.satCount()++; }
+    if (c.satCount() == 0) num_unsat++;
 }
 
 
@@ -210,10 +264,15 @@ void Solver::detachClause(CRef cr, bool strict){
     if (strict){
         remove(watches[~c[0]], Watcher(cr, c[1]));
         remove(watches[~c[1]], Watcher(cr, c[0]));
+        for (int i = 0; i < c.size(); i++)
+            remove(lit_occurs[c[i]], cr);
     }else{
         watches.smudge(~c[0]);
         watches.smudge(~c[1]);
+        for (int i = 0; i < c.size(); i++)
+            lit_occurs.smudge(c[i]);
     }
+    if (c.satCount() == 0) num_unsat--;
 
     if (c.learnt()) num_learnts--, learnts_literals -= c.size();
     else            num_clauses--, clauses_literals -= c.size();
@@ -244,7 +303,8 @@ void Solver::cancelUntil(int level) {
         for (int c = trail.size()-1; c >= trail_lim[level]; c--){
             Var      x  = var(trail[c]);
             assigns [x] = l_Undef;
-            if (phase_saving > 1 || (phase_saving == 1 && c > trail_lim.last()))
+            satCountDown(trail[c]);
+            if (!replaying && (phase_saving > 1 || (phase_saving == 1 && c > trail_lim.last())))
                 polarity[x] = sign(trail[c]);
             insertVarOrder(x); 
         }
@@ -320,14 +380,14 @@ void Solver::analyze(CRef confl, vec<Lit>& out_learnt, int& out_btlevel)
         assert(confl != CRef_Undef); // (otherwise should be UIP)
         Clause& c = ca[confl];
 
-        if (c.learnt())
+        if (c.learnt() && !replaying)
             claBumpActivity(c);
 
         for (int j = (p == lit_Undef) ? 0 : 1; j < c.size(); j++){
             Lit q = c[j];
 
             if (!seen[var(q)] && level(var(q)) > 0){
-                varBumpActivity(var(q));
+                if (!replaying) varBumpActivity(var(q));
                 seen[var(q)] = 1;
                 if (level(var(q)) >= decisionLevel())
                     pathC++;
@@ -502,6 +562,7 @@ void Solver::uncheckedEnqueue(Lit p, CRef from)
     assigns[var(p)] = lbool(!sign(p));
     vardata[var(p)] = mkVarData(from, decisionLevel());
     trail.push_(p);
+    satCountUp(p);
 }
 
 
@@ -627,13 +688,14 @@ void Solver::removeSatisfied(vec<CRef>& cs)
     int i, j;
     for (i = j = 0; i < cs.size(); i++){
         Clause& c = ca[cs[i]];
-        if (satisfied(c))
+        if (isSatisfied(cs[i]))
             removeClause(cs[i]);
         else{
             // Trim clause:
             assert(value(c[0]) == l_Undef && value(c[1]) == l_Undef);
             for (int k = 2; k < c.size(); k++)
                 if (value(c[k]) == l_False){
+                    remove(lit_occurs[c[k]], cs[i]);
                     c[k--] = c[c.size()-1];
                     c.pop();
                 }
@@ -817,7 +879,21 @@ lbool Solver::search(int nof_conflicts) // Comments by Fei: make nof_conflicts a
                 // Comments by Fei: this is the old way to save the state (should optimize it later)
                 // snapState(snapTo, assumptions, mkLit(0,false));
                 // Comments by Fei: this is the new way to save the state. 
-                assert (leaf_shadow == NULL && "at the start step (whether initial step or continued step), leaf_shadow should be NULL");
+                assert (leaf_shadows.size() == 0 && leaf_replays.size() == 0 && "at the start step (whether initial step or continued step), no leaf should be waiting");
+                transpositions.clear(); // (the evaluations of the last search are of its own clauses, and the shadows may be reclaimed below)
+                if (root_replay != NULL) {
+                    // the replay tree keeps statistics only: reuse the subtree of the decision, and discard the rest
+                    replay* temp = root_replay;
+                    root_replay = root_replay -> next_root(toInt(agent_decision));
+                    replay_nodes.discard(temp);
+                }
+                for (int i = 0; i < root_ensemble.size(); i++) {
+                    // the other trees of an ensemble go the same way (a tree that never tried the decision is built again by simulate())
+                    shadow* temp = root_ensemble[i];
+                    root_ensemble[i] = temp == NULL ? NULL : temp -> next_root(toInt(agent_decision));
+                    reclaim_memory(temp);
+                    assert ((root_ensemble[i] == NULL || root_ensemble[i] -> check_state()) && "a root of the ensemble and Solver have different state!");
+                }
                 if (root_shadow == NULL) { 
                     // this is step without shadow tree (or inital stage, no shadow tree yet)
                     // construction of shadow tree is the responsibility of the Solver::simulate() function
@@ -826,6 +902,12 @@ lbool Solver::search(int nof_conflicts) // Comments by Fei: make nof_conflicts a
                     if (!flag) {
                         return l_True; // already solved!
                     }
+                    if (root_replay != NULL && root_replay -> state_key != state_key) {
+                        // the simulation of the decision reached another state than the real step (other clauses were learnt):
+                        // the valid actions and the statistics of the subtree are not those of this state, so it is built again
+                        replay_nodes.discard(root_replay);
+                        root_replay = NULL;
+                    }
 
                     // this is the init stage, no root_shadow yet.
                     // initialize a shadow object for both the root and leaf pointer, call root_shadow's generate_state function
@@ -845,14 +927,18 @@ lbool Solver::search(int nof_conflicts) // Comments by Fei: make nof_conflicts a
                     reclaim_memory(temp);
         		    // check that the root shadow reflect the same state as Solver!! IMPORTANT FOR EDBUGGING
         		    if (!root_shadow) {
-        		    	assert (!generate_state(write_state_to) && "root_shadow is null but Solver is not solved!");
-        		      	return l_True;
-            		}
+        		    	// (in an ensemble, root_shadow may just not have tried the decision: it is built again by simulate())
+        		    	if (!generate_state(write_state_to)) return l_True;
+        		    	assert (root_ensemble.size() > 0 && "root_shadow is null but Solver is not solved!");
+            		} else {
         		    assert (root_shadow->check_state() && "root_shadow and Solver have different state!");
         		    bool flag = generate_state(write_state_to);
         		    assert (flag && "root_shadow is not NULL but Solver state is empty!");
+        		    }
                 } 
                 
+                startMctsBudget();
+                mcts_evaluator = eval_none;
                 env_hold = true;
                 env_reward = -1.0;
                 return l_Undef;
@@ -900,10 +986,10 @@ label2:
         		    int key = toInt(agent_decision);
                     // check that the agent_decision is a valid option from the root_shadow
                     assert (root_shadow -> valid[key] && "agent_decision is not a valid action");
-                    // check that the number of visits for the agent_decision option is larger than 0
-                    assert (root_shadow -> nn[key] > 0 && "agent_decision is never visited in simulation");
+                    // check that the number of visits for the agent_decision option is larger than 0 (in one of the trees, for an ensemble)
+                    assert ((root_ensemble.size() > 0 || root_shadow -> nn[key] > 0) && "agent_decision is never visited in simulation");
                     // check that either child on agent_decision exist or marked done
-                    assert ((root_shadow -> done[key] || root_shadow -> childern[key]) && "agent_decision is neither done nor exists");
+                    assert ((root_ensemble.size() > 0 || root_shadow -> done[key] || root_shadow -> childern[key]) && "agent_decision is neither done nor exists");
                 }
             }
             // Increase decision level and enqueue 'next'
@@ -921,64 +1007,532 @@ label2:
 // 3 -> 11: more simulation needed (dismeet the size constraint), the leaf_shadow state still needs to be evaluated
 // argument array is where the new state will be written to (if there is one to be evaluated)
 // argument pi_input and v are the evaluated values for the last state returned. They should be passed on to the leaf_shadow if leaf_shadow is not NULL
-int Solver::simulate(float* array, float* pi_input, float v) {
-    // simulate is responsible to set up shadow trees if there is none at the entry of this function
+int Solver::simulate(state_out array, float* pi_input, float v) {
+    bool more;
+    int  n = simulate_batch(array, 1, pi_input, &v, more);
+    return int(n > 0) + int(more) * 2;
+}
+
+// The budgets of a move start when search() has written its state (the simulations of the move follow). The memory budget is on the
+// bytes that the trees hold, so the subtrees discarded by the last step are destructed first (instead of when their slots are needed).
+void Solver::startMctsBudget() {
+    mcts_deadline    = mcts_time_budget < 0 ? -1 : realTime() + mcts_time_budget;
+    mcts_prop_target = mcts_prop_budget < 0 ? -1 : (int64_t)mcts_propagations + mcts_prop_budget;
+    if (mcts_mem_budget >= 0) {
+        shadow_nodes.clear();
+        replay_nodes.clear();
+    }
+}
+
+bool Solver::withinMctsBudget() const {
+    return (mcts_deadline    < 0 || realTime() < mcts_deadline)
+        && (mcts_prop_target < 0 || (int64_t)mcts_propagations < mcts_prop_target)
+        && (mcts_mem_budget  < 0 || mctsBytes() < mcts_mem_budget);
+}
+
+// a search goes on until its simulations are used up, its root is proven, or a budget of the move is reached
+// (a new tree gets its first simulation in any case, so that there is a decision to make)
+template<class Node>
+bool Solver::searching(const Node* root) const {
+    return root -> sumN < mcts_size_lim && !root -> proven && (root -> sumN == 0 || withinMctsBudget());
+}
+
+int64_t Solver::mctsBytes() const {
+    if (mcts_replay) return (int64_t)replay_nodes.size() * replay_nodes.node_bytes();
+    return shadow_bytes + (int64_t)shadow_arena.bytes();
+}
+
+int Solver::mctsSimulations() const {
+    if (mcts_replay) return root_replay == NULL ? 0 : (int)root_replay -> sumN;
+    int n = root_shadow == NULL ? 0 : (int)root_shadow -> sumN;
+    for (int i = 0; i < root_ensemble.size(); i++)
+        if (root_ensemble[i] != NULL) n += root_ensemble[i] -> sumN;
+    return n;
+}
+
+// The batched simulate: up to k new leaves are selected in one call, and their states are written to array (the i-th at dims.nth(array, i)).
+// argument pi (waiting_leaves() rows of nact) and v (waiting_leaves() values) are the evaluations of the leaves returned by the last call, in order.
+// return the number of new leaves, and set more to true if more simulation is needed (dismeet the size constraint)
+int Solver::simulate_batch(state_out array, int k, const float* pi, const float* v, bool& more) {
+    // simulate is responsible to set up the tree if there is none at the entry of this function
+    // (the new root waits for its pi, which comes with the first call)
+    if (mcts_replay) {
+        if (root_replay == NULL) {
+            replay_nodes.use_tail(replay::tail_bytes(dims.nact()));
+            root_replay = new (replay_nodes.alloc()) replay(dims.nact());
+            // the valid array of the root is the one of the Solver state, already collected when search() wrote it
+            dims.mark_valid(state_valid, root_replay -> valid);
+            root_replay -> state_key = state_key;
+            root_replay -> valid_is_initialized = true;
+            root_replay -> waiting = true;
+            leaf_replays.push(root_replay);
+        }
+        backup_leaves(leaf_replays, pi, v);
+        explore_leaves(root_replay, leaf_replays, array, k);
+        if (nn_cache != NULL) evaluate_known(leaf_replays, array);
+        more = searching(root_replay);
+        return leaf_replays.size();
+    }
     if (root_shadow == NULL) {
-        root_shadow = leaf_shadow = new shadow(this);
-        // call generate state from root_shadow to initialize the valid array (for MCTS)
+        shadow_nodes.use_tail(shadow::tail_bytes(dims.nact()));
+        root_shadow = new (shadow_nodes.alloc()) shadow(this);
+        // collect the live clauses of root_shadow, and initialize its valid array (for MCTS)
         root_shadow -> generate_valid();
+        root_shadow -> waiting = true;
+        leaf_shadows.push(root_shadow);
+    }
+    if (mcts_transpose)
+        for (int i = 0; i < leaf_shadows.size(); i++)   // (their value is set by backup_leaves, just below)
+            if (leaf_shadows[i] -> transposable()) transpositions.emplace(leaf_shadows[i] -> hash, leaf_shadows[i]);
+    backup_leaves(leaf_shadows, pi, v);
+    if (mcts_trees > 1)                 explore_ensemble(array, k);
+    else if (mcts_threads > 1 && k > 1) explore_parallel(root_shadow, leaf_shadows, array, k);
+    else                                explore_leaves(root_shadow, leaf_shadows, array, k);
+    if (mcts_transpose || nn_cache != NULL) evaluate_known(leaf_shadows, array);
+    more = searching(root_shadow);
+    for (int i = 0; i < root_ensemble.size(); i++)
+        more = more || searching(root_ensemble[i]);
+    more = more && proven_root() == NULL; // (the decision is known)
+    return leaf_shadows.size();
+}
+
+// The native search: simulate_batch is called until the MCTS of this move is complete, and the states of the leaves are evaluated here,
+// by nn_net (on the float states, in one batch of up to k), or by a heuristic prior (on the packed states, which it reads directly).
+// A new root is evaluated first, from the state of this Solver.
+int Solver::simulate_native(int prior, int k) {
+    if (mcts_evaluator == eval_caller || waiting_leaves() > 0)
+        throw std::invalid_argument("simulate_native can not go on with the search of simulate in the same move");
+    if (prior == prior_model && (nn_net == NULL || !nn_net -> fits(dims)))
+        throw std::invalid_argument("simulate_native has no model for the states");
+    mcts_evaluator = eval_native;
+    bool         model = prior == prior_model;                // (the model reads the float states, the priors the packed ones)
+    vec<uint8_t> states(model ? 0 : k * dims.packed_size(), 0);
+    vec<float>   floats(model ? k * dims.size() : 0, 0);
+    vec<float>   pi(k * dims.nact(), 0);
+    vec<float>   v(k, 0);
+    state_out    out = model ? state_out(&floats[0]) : state_out::packed_to(&states[0]);
+
+    int  n = 0;
+    bool more;
+    if (mcts_replay ? root_replay == NULL : root_shadow == NULL) {
+        generate_state(out);
+        n = 1;
     }
+    do {
+        if (model)
+            nn_net -> evaluate(&floats[0], n, &pi[0], &v[0]);
+        else
+            for (int i = 0; i < n; i++)
+                heuristic_prior(prior, dims.nth(out, i).packed, &pi[i * dims.nact()]);
+        if (model) memset(&floats[0], 0, floats.size() * sizeof(float));
+        else       memset(&states[0], 0, states.size());
+        n = simulate_batch(out, k, &pi[0], &v[0], more);
+    } while (n > 0 || more);
+    return mctsSimulations();
+}
 
-    // if leaf_shadow is not NULL, write the pi and v values to leaf_shadow!
-    if (leaf_shadow != NULL) {
-        // pass the pi to the right leaf node
-        for (int i = 0; i < Hyper_Const::nact; i++) {
-            leaf_shadow -> pi[i] = pi_input[i];
-        }
-        // back propagate v for parents of the leaf node
-        shadow* temp = leaf_shadow;
-        while (temp -> parent != NULL) {
-            temp = temp -> parent;
-            temp -> qu[ temp -> index_child_last_pick ] += v;
-            // temp -> sumN += 1; this is already done at exploration stage
-            // temp -> nn[ temp -> index_child_last_pick ] += 1; this is already done at exploration stage
+// The priors are normalized over the valid actions of the state (the literals in its clauses):
+//   prior_uniform    -- the same for every valid action
+//   prior_activity   -- the VSIDS activity of the variable of the action (in the real state: the simulations do not bump it)
+//   prior_jw         -- the Jeroslow-Wang score of the literal: the sum of 2^-len over the clauses of the state it is in (len is the
+//                       number of literals of the clause that are not false, so that short clauses count the most)
+//   prior_occurrence -- the number of clauses of the state the literal is in
+void Solver::heuristic_prior(int prior, const uint8_t* packed, float* pi) const {
+    int     nact      = dims.nact();
+    int     col_bytes = dims.col_bytes();
+    const uint8_t* valid = packed + dims.dim0 * col_bytes;
+    double  score[Hyper_Const::max_nact] = {};
+
+    if (prior == prior_jw || prior == prior_occurrence) {
+        for (int c = 0; c < dims.dim0; c++) {
+            const uint8_t* col = packed + c * col_bytes;
+            int len = 0;
+            for (int i = 0; i < col_bytes; i++) len += __builtin_popcount(col[i]);
+            if (len == 0) break;                                // (the columns past the last clause are zero)
+            double w = prior == prior_jw ? ldexp(1.0, -len) : 1.0;
+            for (int a = 0; a < nact; a++)
+                if ((col[a >> 3] >> (a & 7)) & 1) score[a] += w;
         }
     }
+    double sum = 0;
+    for (int a = 0; a < nact; a++) {
+        if (!((valid[a >> 3] >> (a & 7)) & 1)) { score[a] = 0; continue; }
+        if      (prior == prior_uniform)  score[a] = 1;
+        else if (prior == prior_activity) score[a] = activity[a >> 1] + 1e-6 * var_inc;  // (so that no valid action is 0)
+        sum += score[a];
+    }
+    for (int a = 0; a < nact; a++)
+        pi[a] = sum > 0 ? (float)(score[a] / sum) : 0;
+}
 
-    // if total number of simulations is reached, return 0 (no more evaluation or simulation to be done)
-    if (root_shadow -> sumN >= Hyper_Const::MCTS_size_lim) {
-        leaf_shadow = NULL;
-        return 0; 
+// write the pi and v values to the waiting leaves, and back propagate v for their parents
+template<class Node>
+void Solver::backup_leaves(vec<Node*>& leaves, const float* pi, const float* v) {
+    for (int j = 0; j < leaves.size(); j++) {
+        Node* leaf = leaves[j];
+        for (int i = 0; i < leaf -> nact; i++) {
+            leaf -> pi[i] = pi[j * leaf -> nact + i];
+        }
+        if (nn_cache != NULL) nn_cache -> insert(leaf -> state_key, leaf -> nact, pi + j * leaf -> nact, v[j]);
+        leaf -> backup(v[j]);
     }
+    leaves.clear();
+}
 
-    // otherwise, do a simulation step (call next_to_explore) from the root_shadow.
-    // if return is NULL, MCTS stepped into a finished state,
-    // else, the state of the new node will be written in "array".
-    leaf_shadow = root_shadow -> next_to_explore(array);
-    while (leaf_shadow == NULL) {
+// do simulation steps (call explore) from the root, until there are k new leaves or the total number of simulations is reached.
+// if explore returns NULL, MCTS stepped into a finished state (the simulation counts, but there is nothing to evaluate),
+// if it returns a leaf that is already waiting, the selection ran into this batch: its visit is undone and the batch is closed,
+// else, the state of the new leaf is written in its place in "array", and it waits (with a virtual loss on its path).
+template<class Node>
+void Solver::explore_leaves(Node* root, vec<Node*>& leaves, state_out array, int k) {
+    while (leaves.size() < k && searching(root)) {
+        Node* leaf = explore(root, dims.nth(array, leaves.size()));
         /* Comments by Fei: change of mind >>>> finished state should return 0.0 (average, or no-information value)
         for (shadow* temp = root_shadow; temp != NULL; temp = temp -> childern[temp->index_child_last_pick]) {
             temp -> qu [temp -> index_child_last_pick] += 1.0; // finished state return v of 1.0 (highest)
         } */
-        if (root_shadow -> sumN >= Hyper_Const::MCTS_size_lim) break;
-        leaf_shadow = root_shadow -> next_to_explore(array);
+        if (leaf == NULL) continue;
+        if (leaf -> waiting) {
+            leaf -> revert_visit();
+            break;
+        }
+        leaf -> waiting = true;
+        leaf -> add_vloss();
+        leaves.push(leaf);
     }
-    return int(leaf_shadow != NULL) + int(root_shadow -> sumN < Hyper_Const::MCTS_size_lim) * 2;
 }
 
-void Solver::reclaim_memory(shadow* root) {
-    for (int i = 0; i < Hyper_Const::nact; i++) {
-        if (root -> childern[i]) {
-            reclaim_memory(root -> childern[i]);
+// The same as explore_leaves, by mcts_threads threads (this one and mcts_threads - 1 more) that select and expand in the tree at once
+// (see shadow::next_to_explore for how they share it). Each thread holds a slot of "array" for the state of its next leaf. A thread
+// stops when the batch is full, when the simulations are used up, or when its selection runs into a waiting leaf (which closes the
+// batch in the serial loop). The slots that were taken but not filled are closed up at the end, so the leaves are the first slots.
+void Solver::explore_parallel(shadow* root, vec<shadow*>& leaves, state_out array, int k) {
+    share_with_threads();
+    root -> add_dirichlet_noise();
+
+    int nthreads = std::min(mcts_threads, k);
+    std::atomic<int> next_slot(0);
+    std::atomic<int> budget(mcts_size_lim - root -> sumN);
+    std::vector<shadow*> slots(k, (shadow*)NULL);
+    std::vector<vec<shadow*> > finished(nthreads);
+    std::vector<std::exception_ptr> failed(nthreads);
+
+    auto work = [&](int id) {
+        try {
+            int slot = -1;
+            while (searching(root)) {
+                if (slot < 0 && (slot = next_slot++) >= k) break;
+                if (budget-- <= 0) break;
+                bool collided;
+                shadow* leaf = root -> next_to_explore(dims.nth(array, slot), finished[id], collided);
+                if (collided) { budget++; break; }
+                if (leaf != NULL) { slots[slot] = leaf; slot = -1; }
+            }
+        } catch (...) {
+            failed[id] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> team;
+    for (int id = 1; id < nthreads; id++) team.push_back(std::thread(work, id));
+    work(0);
+    for (int id = 0; id < (int)team.size(); id++) team[id].join();
+
+    // the childern that stepped into a finished state are taken out now, as next_to_explore(state_out) does right away
+    for (int id = 0; id < nthreads; id++)
+        for (int i = 0; i < finished[id].size(); i++) {
+            shadow* s = finished[id][i];
+            s -> parent -> childern[s -> action] = NULL;
+            shadow_nodes.free(s);
+        }
+
+    // move the last leaves into the empty slots
+    int n = std::min((int)next_slot, k);
+    for (int i = 0; i < n; i++) {
+        if (slots[i] != NULL) continue;
+        while (n > i + 1 && slots[n - 1] == NULL) n--;
+        if (n == i + 1) { n = i; break; }
+        dims.move(array, n - 1, i);
+        slots[i] = slots[n - 1];
+        n--;
+    }
+    for (int i = 0; i < n; i++)
+        leaves.push(slots[i]);
+
+    for (int id = 0; id < nthreads; id++)
+        if (failed[id]) std::rethrow_exception(failed[id]);
+}
+
+// Root parallel MCTS: root_shadow and the mcts_trees - 1 roots of root_ensemble are independent searches from the state of this Solver,
+// each with its own dirichlet noise, run at once by one thread each. A new tree starts with the pi of root_shadow, which is the
+// evaluation of the same state (so the caller evaluates it once). The k slots of "array" are shared out to the trees that need more
+// simulations, each tree collects its leaves in its own range (with explore_leaves), and the ranges are closed up at the end, so
+// that the leaves are in the order of the trees. The trees have only the Solver (read only), the shadow pool and the arena in common.
+// The decision is made on the sum of the visit counts of the trees (see get_visit_count).
+void Solver::explore_ensemble(state_out array, int k) {
+    vec<shadow*> active;
+    // a new tree copies the pi of root_shadow from before its noise, so that each tree has a draw of its own
+    if (!root_shadow -> dirichlet_noise_has_been_added) {
+        root_pi.growTo(dims.nact());
+        for (int a = 0; a < dims.nact(); a++) root_pi[a] = root_shadow -> pi[a];
+    }
+    while (root_ensemble.size() < mcts_trees - 1) root_ensemble.push(NULL);
+    for (int i = -1; i < root_ensemble.size(); i++) {
+        if (i >= 0 && root_ensemble[i] == NULL) {
+            root_ensemble[i] = new (shadow_nodes.alloc()) shadow(this);
+            root_ensemble[i] -> generate_valid();
+            for (int a = 0; a < dims.nact(); a++)
+                root_ensemble[i] -> pi[a] = root_pi[a];
+        }
+        shadow* root = i < 0 ? root_shadow : root_ensemble[i];
+        root -> add_dirichlet_noise();
+        if (searching(root)) active.push(root);
+    }
+    share_with_threads();
+
+    int ntrees = std::min(active.size(), k);
+    std::vector<vec<shadow*> > found(ntrees);
+    std::vector<std::exception_ptr> failed(ntrees);
+    auto work = [&](int t) {
+        try {
+            explore_leaves(active[t], found[t], dims.nth(array, t * k / ntrees), (t + 1) * k / ntrees - t * k / ntrees);
+        } catch (...) {
+            failed[t] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> team;
+    for (int t = 1; t < ntrees; t++) team.push_back(std::thread(work, t));
+    if (ntrees > 0) work(0);
+    for (int t = 0; t < (int)team.size(); t++) team[t].join();
+
+    for (int t = 0; t < ntrees; t++)
+        for (int j = 0; j < found[t].size(); j++) {
+            if (t * k / ntrees + j != leaf_shadows.size()) dims.move(array, t * k / ntrees + j, leaf_shadows.size());
+            leaf_shadows.push(found[t][j]);
         }
+
+    for (int t = 0; t < ntrees; t++)
+        if (failed[t]) std::rethrow_exception(failed[t]);
+}
+
+// Transpositions: the same state can be reached by different orders of actions (x1 then x2, or x2 then x1). The state of a transposable
+// shadow (see shadow::transposable) is a function of its assignment, so two of them with the same assignment need one evaluation only.
+// The evaluated ones of this search are kept by the Zobrist hash of their assignment (see zobrist()), and the assignments are compared
+// on a match, so a collision of hashes cannot share an evaluation. The nodes themselves are not merged (each keeps its own statistics),
+// as the tree must stay a tree for the paths of backup and virtual loss, and for the subtrees that the pools discard.
+shadow* Solver::find_transposition(shadow* leaf) {
+    if (!leaf -> transposable()) return NULL;
+    std::unordered_map<uint64_t, shadow*>::const_iterator it = transpositions.find(leaf -> hash);
+    if (it == transpositions.end()) return NULL;
+    shadow* twin = it -> second;
+    for (Var x = 0; x < nVars(); x++)
+        if (twin -> assigns[x] != leaf -> assigns[x]) return NULL;
+    return twin;
+}
+
+// the pi and v of a new leaf are known if a shadow in the same state was evaluated in this search (see above), or if its state is in
+// nn_cache (from an earlier search, or an other Solver of the same network)
+bool Solver::known_evaluation(shadow* leaf, float& v) {
+    shadow* twin = mcts_transpose ? find_transposition(leaf) : NULL;
+    if (twin != NULL) {
+        for (int a = 0; a < leaf -> nact; a++)
+            leaf -> pi[a] = twin -> pi[a];
+        v = twin -> v_eval;
+        return true;
+    }
+    return nn_cache != NULL && nn_cache -> lookup(leaf -> state_key, leaf -> nact, leaf -> pi, v);
+}
+
+bool Solver::known_evaluation(replay* leaf, float& v) {
+    return nn_cache != NULL && nn_cache -> lookup(leaf -> state_key, leaf -> nact, leaf -> pi, v);
+}
+
+// the new leaves of this call (in leaves, with their states in array) whose evaluation is known take it at once: they are backed up
+// (which also removes their virtual loss), their states are cleared, and the rest are moved up to fill the batch again.
+template<class Node>
+void Solver::evaluate_known(vec<Node*>& leaves, state_out array) {
+    int j = 0;
+    for (int i = 0; i < leaves.size(); i++) {
+        Node* leaf = leaves[i];
+        float v;
+        if (known_evaluation(leaf, v)) {
+            leaf -> backup(v);
+            dims.clear(array, i);
+            continue;
+        }
+        if (i != j) dims.move(array, i, j);
+        leaves[j++] = leaf;
     }
-    root -> ~shadow();
+    leaves.shrink(leaves.size() - j);
 }
 
+// The shadows of several threads read the Solver at once, so it must not change under them: the occurence lists are cleaned
+// now, because lookup() cleans them on the fly. (Nothing else of the Solver is written while its MCTS explores.)
+void Solver::share_with_threads() {
+    watches.cleanAll();
+    lit_occurs.cleanAll();
+}
+
+shadow* Solver::explore(shadow* root, state_out array) {
+    return root -> next_to_explore(array);
+}
 
-// this function passes array to the root_shadow, who then write the nn array (visit count) to array
+// One simulation of the replay backend: the actions from the root to a new leaf are applied to this Solver,
+// the state of the new leaf is written to "array", and the Solver is restored to the real state before returning.
+// A NULL return means that the simulation stepped into a finished state (no evaluation needed).
+// Only a finished child of the root proves it (see mcts_node::prove): the root is the real state, while the state of a node below it
+// is recomputed on each visit, and may not step into the same finished state again.
+replay* Solver::explore(replay* root, state_out array) {
+    replay_save();
+    replay* node = root;
+    replay* new_leaf = NULL;
+    while (true) {
+        assert (node -> valid_is_initialized && "time to explore but the valid [] is still not initialized");
+        int pick = node -> pick_child();
+        Lit p    = toLit(pick);
+        if (node -> done[pick]) break;
+        // the state of a node is recomputed on every visit, and may differ from the first visit (other learnt clauses):
+        // an action that is no longer open ends the simulation without evaluation
+        if (value(p) != l_Undef) break;
+
+        replay* next = node -> childern[pick];
+        if (next != NULL) {
+            if (next -> waiting) { new_leaf = next; break; } // ran into this batch
+            if (!replay_step(p)) break;
+            node = next;
+            continue;
+        }
+
+        replay* child = new (replay_nodes.alloc()) replay(node, pick);
+        node -> done[pick] = !(replay_step(p) && generate_state(array, child -> valid));
+        if (node -> done[pick]) {
+            replay_nodes.free(child);
+            if (node == root) node -> prove();
+        } else {
+            child -> state_key = state_key;
+            child -> valid_is_initialized = true;
+            node -> childern[pick] = new_leaf = child;
+        }
+        break;
+    }
+    replay_undo();
+    return new_leaf;
+}
+
+void Solver::replay_save() {
+    replay_cp.level        = decisionLevel();
+    replay_cp.trail0       = trail_lim.size() > 0 ? trail_lim[0] : trail.size();
+    replay_cp.min_level    = decisionLevel() + 1;
+    replay_cp.n_learnts    = learnts.size();
+    replay_cp.simpDB_props = simpDB_props;
+    replay_cp.propagations = propagations;
+    replay_cp.decisions.clear();
+    for (int i = 0; i < trail_lim.size(); i++) {
+        int end = i + 1 < trail_lim.size() ? trail_lim[i + 1] : trail.size();
+        replay_cp.decisions.push(trail_lim[i] < end ? trail[trail_lim[i]] : lit_Undef);
+    }
+    replaying = true;
+}
+
+// Same as one decision of 'search()', but without restarts, simplification, reduceDB or activity updates.
+bool Solver::replay_step(Lit p) {
+    newDecisionLevel();
+    uncheckedEnqueue(p);
+
+    CRef confl;
+    while ((confl = propagate()) != CRef_Undef) {
+        if (decisionLevel() == 0) return false;
+
+        vec<Lit> learnt_clause;
+        int backtrack_level;
+        analyze(confl, learnt_clause, backtrack_level);
+        cancelUntil(backtrack_level);
+        if (backtrack_level < replay_cp.min_level) replay_cp.min_level = backtrack_level;
+
+        if (learnt_clause.size() == 1){
+            uncheckedEnqueue(learnt_clause[0]);
+        }else{
+            CRef cr = ca.alloc(learnt_clause, true);
+            learnts.push(cr);
+            attachClause(cr);
+            uncheckedEnqueue(learnt_clause[0], cr);
+        }
+    }
+    return true;
+}
+
+void Solver::replay_undo() {
+    mcts_propagations += propagations - replay_cp.propagations;
+    if (replay_cp.min_level > replay_cp.level) {
+        // the simulation stayed above the real state: the trail below is untouched
+        cancelUntil(replay_cp.level);
+    } else if (replay_cp.min_level > 0) {
+        // backjumped into the real state: drop the levels that changed, and redo their decisions below
+        cancelUntil(replay_cp.min_level - 1);
+    } else {
+        // backjumped to the top level: also drop the top-level facts learnt during the simulation
+        cancelUntil(0);
+        for (int c = trail.size() - 1; c >= replay_cp.trail0; c--) {
+            assigns[var(trail[c])] = l_Undef;
+            satCountDown(trail[c]);
+            insertVarOrder(var(trail[c]));
+        }
+        trail.shrink(trail.size() - replay_cp.trail0);
+        qhead = trail.size();
+    }
+
+    // remove the clauses learnt during the simulation (none of them is a reason anymore)
+    for (int i = replay_cp.n_learnts; i < learnts.size(); i++)
+        removeClause(learnts[i]);
+    learnts.shrink(learnts.size() - replay_cp.n_learnts);
+
+    // the propagation of the real decisions reaches the same assignment as before (with the same clauses)
+    while (decisionLevel() < replay_cp.level) {
+        Lit next = replay_cp.decisions[decisionLevel()];
+        newDecisionLevel();
+        if (next != lit_Undef) uncheckedEnqueue(next);
+        CRef confl = propagate();
+        assert (confl == CRef_Undef && "replay: the real state can not be restored");
+        (void)confl;
+    }
+
+    simpDB_props = replay_cp.simpDB_props;
+    replaying = false;
+    checkGarbage();
+}
+
+// the subtree is handed over to the shadow pool, which destructs the shadows lazily when their memory is needed again
+void Solver::reclaim_memory(shadow* root) {
+    shadow_nodes.discard(root);
+}
+
+
+// this function passes array to the root of MCTS, who then write the nn array (visit count) to array
+// (the visits as they are, also of a proven root: its shortest line is get_proven_action)
 void Solver::get_visit_count(float* array) {
+    if (mcts_replay) { root_replay -> get_visit_count(array); return; }
     root_shadow -> get_visit_count(array);
+    // an ensemble decides on the visits of all of its trees
+    for (int i = 0; i < root_ensemble.size(); i++)
+        if (root_ensemble[i] != NULL)
+            for (int a = 0; a < dims.nact(); a++) array[a] += root_ensemble[i] -> nn[a];
+}
+
+// the first action of the shortest proven line of the roots (of an ensemble, the shortest of its trees), or -1 if no root is proven
+int Solver::get_proven_action() const {
+    if (mcts_replay) return root_replay == NULL ? -1 : root_replay -> proven_action();
+    const shadow* best = NULL;
+    for (int i = -1; i < root_ensemble.size(); i++) {
+        const shadow* root = i < 0 ? root_shadow : root_ensemble[i];
+        if (root != NULL && root -> proven && (best == NULL || root -> proven_depth < best -> proven_depth)) best = root;
+    }
+    return best == NULL ? -1 : best -> proven_action();
+}
+
+shadow* Solver::proven_root() const {
+    if (root_shadow != NULL && root_shadow -> proven) return root_shadow;
+    for (int i = 0; i < root_ensemble.size(); i++)
+        if (root_ensemble[i] != NULL && root_ensemble[i] -> proven) return root_ensemble[i];
+    return NULL;
 }
 
 double Solver::progressEstimate() const
@@ -1291,15 +1845,12 @@ void Solver::saveState(const vec<Lit>& assumps) {
         return; 
     }
 
-    // First: count the unresolved clauses.
+    // First: count the unresolved clauses (the learnt ones are the rest of the unsatisfied clauses).
     int cnt_clause = 0;
-    int cnt_learnt = 0;
     for (int i = 0; i < clauses.size(); i++)
-        if (!satisfied(ca[clauses[i]]))
+        if (!isSatisfied(clauses[i]))
             cnt_clause++;
-    for (int i = 0; i < learnts.size(); i++)
-        if (!satisfied(ca[learnts[i]]))
-            cnt_learnt++;
+    int cnt_learnt = nUnsat() - cnt_clause;
     // NOTE: if we ever need assumps later, we need to add it into estimate_size calculation!
 
     if (cnt_clause == 0 && cnt_learnt == 0) {
@@ -1337,17 +1888,16 @@ void Solver::saveState(const vec<Lit>& assumps) {
     int temp = snprintf(env_state, env_state_size, "p cnf %d %d\n", next_var, cnt_clause + cnt_learnt + assumps.size());
     used_space = handle_writting_state(temp, used_space);
     for (int i = 0; i < clauses.size(); i++) {
-        used_space = saveState(ca[clauses[i]], used_space);
+        if (!isSatisfied(clauses[i])) used_space = saveState(ca[clauses[i]], used_space);
     }
     for (int i = 0; i < learnts.size(); i++){
-        used_space = saveState(ca[learnts[i]], used_space);
+        if (!isSatisfied(learnts[i])) used_space = saveState(ca[learnts[i]], used_space);
     }
 
 }
 
-// Comments by Fei: this function writes each clause
+// Comments by Fei: this function writes each clause (that is not satisfied)
 int Solver::saveState(Clause& c, int used_space) {
-    if (satisfied(c)) return used_space;
     for (int i = 0; i < c.size(); i++) {
         if (value(c[i]) != l_False) {
             int temp = snprintf(env_state + used_space, env_state_size - used_space, "%s%d ", sign(c[i]) ? "-" : "", var(c[i])+1);
@@ -1372,51 +1922,55 @@ int Solver::handle_writting_state(int temp, int used_space) {
     else return temp + used_space;
 }
 
-// helper function for generate_state (write state to a 1D array and returns the next col to write to)
-int Solver::write_clause(const Clause& c, int index_col, float* array) {
-    if (satisfied(c)) return index_col;
-    for (int i = 0; i < c.size(); i++) {
-        if (value(c[i]) != l_False) {
-            int index_row = var(c[i]); int index_z = int(sign(c[i]));
-            int index = index_z + index_row * Hyper_Const::dim2 + index_col * Hyper_Const::dim1 * Hyper_Const::dim2;
-            array[index] = 1.0;
-        }
+// write state in tensor "array" as side effect (if too many clauses to write, cut off by dim0), and mark the valid actions (if valid is given)
+// the valid actions are also kept in state_valid, for the root of a new MCTS tree at this state
+// return true if state is not empty (not solved), false otherwise
+bool Solver::generate_state(state_out out, bool* valid) {
+    state_valid.clear();
+    state_valid.growTo(dims.col_words(), 0);
+    if (out.nowhere() && valid == NULL) return nUnsat() > 0; // nothing to write (not in a gym environment)
+    switch (state_words(dims)) {
+    case 1:  return generate_state<1>(out, valid);
+    case 2:  return generate_state<2>(out, valid);
+    default: return generate_state<4>(out, valid);
     }
-    return index_col + 1;
 }
-// write state in tensor "array" as side effect (if too many clauses to write, cut off by dim0)
-// return true if state is not empty (not solved), false otherwise
-bool Solver::generate_state(float* array) {
-    int index_col = 0;
-    for (int i = 0; i < clauses.size() && index_col < Hyper_Const::dim0; i++) 
-        index_col = write_clause(ca[clauses[i]], index_col, array);
+
+template<int W>
+bool Solver::generate_state(state_out out, bool* valid) {
+    if (nUnsat() == 0) return false; // every clause is satisfied (solved)
+    state_writer<W> w(out, dims);
+    for (int i = 0; i < clauses.size() && !w.full(); i++) 
+        if (!isSatisfied(clauses[i])) w.write(*this, ca[clauses[i]]);
     // write learnts in array
-    for (int i = 0; i < learnts.size() && index_col < Hyper_Const::dim0; i++)
-        index_col = write_clause(ca[learnts[i]], index_col, array);
+    for (int i = 0; i < learnts.size() && !w.full(); i++)
+        if (!isSatisfied(learnts[i])) w.write(*this, ca[learnts[i]]);
+    w.finish();
+    for (int i = 0; i < state_valid.size(); i++) state_valid[i] = w.valid_mask()[i];
+    state_key = w.key();
+    if (valid != NULL) dims.mark_valid(state_valid, valid);
     /* printf("clause %d, learnts %d\n", clauses.size(), learnts.size());
     for (int i = 0; i < trail.size(); i++) {
         printf("%d_", trail[i].x);
     }
     printf("\n");
-    for (int i = 0; i < Hyper_Const::dim1; i++) {
+    for (int i = 0; i < nVars(); i++) {
         printf("%d_", assigns[i]);
     }
     printf("\n"); */ 
-    return index_col > 0;
+    return w.size() > 0;
 }
 
 // this function checks that, if some var never exist in all clauses, then assign true to it in assign vec 
 // this function is no longer necessary once I added valid[] in shadow
 void Solver::check_exist() {
-    bool has_var[Hyper_Const::dim1];
-    for (int i = 0; i < Hyper_Const::dim1; i++)
-        has_var[i] = false;
+    vec<bool> has_var(nVars(), false);
     for (int i = 0; i < clauses.size(); i++) {
         const Clause& c = ca[clauses[i]];
         for (int j = 0; j < c.size(); j++) 
             has_var[var(c[j])] = true;
     }
-    for (int i = 0; i < Hyper_Const::dim1; i++) 
+    for (int i = 0; i < nVars(); i++) 
         if (!has_var[i]) 
             assigns[i] = l_True;
 }
@@ -1482,6 +2036,16 @@ void Solver::relocAll(ClauseAllocator& to)
             clauses[j++] = clauses[i];
         }
     clauses.shrink(i - j);
+
+    // All occurrences:
+    //
+    lit_occurs.cleanAll();
+    for (int v = 0; v < nVars(); v++)
+        for (int s = 0; s < 2; s++){
+            vec<CRef>& cs = lit_occurs[mkLit(v, s)];
+            for (int j = 0; j < cs.size(); j++)
+                ca.reloc(cs[j], to);
+        }
 }
 
 
@@ -1497,3 +2061,61 @@ void Solver::garbageCollect()
                ca.size()*ClauseAllocator::Unit_Size, to.size()*ClauseAllocator::Unit_Size);
     to.moveTo(ca);
 }
+
+
+//=================================================================================================
+// Copying a problem:
+
+
+// The clauses are copied as the words of the allocator, so every CRef (in the clause lists, the watchers, the occurrence lists
+// and the reasons) stays valid in the copy.
+void Solver::copyProblem(const Solver& from)
+{
+    assert(nVars() == 0 && "copyProblem() is for a new Solver");
+    assert(from.decisionLevel() == 0 && !from.env_hold && from.root_shadow == NULL && from.root_replay == NULL
+           && "copyProblem() is for a Solver that has not started solving");
+
+    from.ca.copyTo(ca);
+    from.clauses  .copyTo(clauses);
+    from.learnts  .copyTo(learnts);
+    from.trail    .copyTo(trail);
+    trail.capacity(from.nVars() + 1);        // (uncheckedEnqueue() pushes without growing, as newVar() has made the room)
+    from.trail_lim.copyTo(trail_lim);
+    from.activity .copyTo(activity);
+    from.assigns  .copyTo(assigns);
+    from.polarity .copyTo(polarity);
+    from.user_pol .copyTo(user_pol);
+    from.decision .copyTo(decision);
+    from.vardata  .copyTo(vardata);
+    from.watches  .copyTo(watches);
+    from.lit_occurs.copyTo(lit_occurs);
+    from.order_heap.copyTo(order_heap);
+    from.released_vars.copyTo(released_vars);
+    from.free_vars.copyTo(free_vars);
+    from.seen     .copyTo(seen);
+
+    num_unsat         = from.num_unsat;
+    ok                = from.ok;
+    cla_inc           = from.cla_inc;
+    var_inc           = from.var_inc;
+    qhead             = from.qhead;
+    simpDB_assigns    = from.simpDB_assigns;
+    simpDB_props      = from.simpDB_props;
+    progress_estimate = from.progress_estimate;
+    remove_satisfied  = from.remove_satisfied;
+    next_var          = from.next_var;
+    random_seed       = from.random_seed;
+
+    solves = from.solves; starts = from.starts; decisions = from.decisions; rnd_decisions = from.rnd_decisions;
+    propagations = from.propagations; conflicts = from.conflicts; dec_vars = from.dec_vars;
+    num_clauses = from.num_clauses; num_learnts = from.num_learnts; clauses_literals = from.clauses_literals;
+    learnts_literals = from.learnts_literals; max_literals = from.max_literals; tot_literals = from.tot_literals;
+}
+
+
+void Solver::reserveClauses(int n, int64_t literals)
+{
+    assert(n >= 0 && literals >= 0);
+    ca.reserve(n, literals);
+    clauses.capacity(clauses.size() + n);
+}
@@ -21,12 +21,18 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef Minisat_Solver_h
 #define Minisat_Solver_h
 
+#include <unordered_map>
+
 #include "minisat/mtl/Vec.h"
 #include "minisat/mtl/Heap.h"
 #include "minisat/mtl/Alg.h"
 #include "minisat/mtl/IntMap.h"
 #include "minisat/utils/Options.h"
 #include "minisat/core/SolverTypes.h"
+#include "minisat/core/node_pool.h"
+#include "minisat/core/state.h"
+#include "minisat/core/eval_cache.h"
+#include "minisat/core/nn_model.h"
 
 
 namespace Minisat {
@@ -35,6 +41,7 @@ namespace Minisat {
 // Solver -- the main class:
 
 class shadow; // Comments by Fei: add this class for simulation
+class replay;
 
 class Solver {
 public:
@@ -92,8 +99,9 @@ public:
     int     saveState(Clause& c, int used_space);            // Comments by Fei: sub-routine to a clause
     int     handle_writting_state(int temp, int used_space); // Comments by Fei: sub-routine to handle snprintf.
 
-    bool    generate_state(float* array);                    // Comments by Fei: directly write state to a float array 
-    int     write_clause(const Clause&, int, float*);        // Comments by Fei: sub-routine use by generate_state()  
+    bool    generate_state(state_out out, bool* valid = NULL);         // Comments by Fei: directly write state to a float array or packed bytes (and mark the valid actions, if given)
+    template<int W>
+    bool    generate_state(state_out out, bool* valid);                // ... for the state_writer<W> of dims
     void    check_exist();                                   // Comments by Fei: this function assigns true to vars that don't show up in any clauses
 
 
@@ -118,6 +126,7 @@ public:
     int     nClauses   ()      const;       // The current number of original clauses.
     int     nLearnts   ()      const;       // The current number of learnt clauses.
     int     nVars      ()      const;       // The current number of variables.
+    int     nUnsat     ()      const;       // The current number of (problem and learnt) clauses with no true literal.
     int     nFreeVars  ()      const;
     void    printStats ()      const;       // Print some current statistics to standard output.
 
@@ -126,6 +135,16 @@ public:
     void    setConfBudget(int64_t x);
     void    setPropBudget(int64_t x);
     void    budgetOff();
+
+    // Resource contraints of the MCTS of each move (besides mcts_size_lim simulations). Unlike the budgets above, they hold for every
+    // move: the search of a move stops at whichever is reached first (a new tree still gets its first simulation).
+    //
+    void    setMctsTimeBudget(double seconds); // Wall time of a move, from when search() writes its state.
+    void    setMctsPropBudget(int64_t x);      // Propagations of the simulations of a move.
+    void    setMctsMemBudget (int64_t bytes);  // Bytes held by the search trees (see mctsBytes()).
+    void    mctsBudgetOff();
+    int64_t mctsBytes() const;                 // The bytes of the shadows and their arena (shadow backend), or of the replay nodes.
+    int     mctsSimulations() const;           // The simulations of the search of this move so far (summed over the trees).
     void    interrupt();          // Trigger a (potentially asynchronous) interruption of the solver.
     void    clearInterrupt();     // Clear interrupt indicator flag.
 
@@ -135,6 +154,14 @@ public:
     void    checkGarbage(double gf);
     void    checkGarbage();
 
+    // Copy the problem of 'from' (clauses, top-level assignment, heuristic state, statistics) into this new Solver, instead of adding its
+    // clauses again. 'from' must not have started solving (see GymSolver's ProblemCache); the settings of the gym and of MCTS are not copied.
+    void    copyProblem(const Solver& from);
+
+    // Make room for that many more problem clauses, of that many literals in all, before adding them (one reallocation of the clauses,
+    // instead of one each time the allocator is full).
+    void    reserveClauses(int clauses, int64_t literals);
+
     // Extra results: (read-only member variable)
     //
     vec<lbool> model;             // If problem is satisfiable, this vector contains the model (if any).
@@ -163,7 +190,10 @@ public:
 
     int       learntsize_adjust_start_confl;
     double    learntsize_adjust_inc;
-    float*    write_state_to;     // Comments by Fei. this is the pointer to array of state (memory is in RL algorithm)
+    state_out write_state_to;     // Comments by Fei. this is the pointer to array of state (memory is in RL algorithm), float tensor or packed (see state.h)
+    state_dims dims;              // The size of the states (and the number of actions) of this Solver. Set before the first state is written.
+    vec<uint64_t> state_valid;    // The valid actions (bit toInt(lit)) of the last state written by generate_state(), for a new MCTS root.
+    uint64_t  state_key;          // The key of the last state written by generate_state() (see state_writer::key).
     char*     snapTo;             // Comments by Fei. this is the filename to write down snapState.
     bool      env_hold;           // Comments by Fei. this is the for adapting solver to Reinforcement Learning environment. 
                                   // Comments by Fei. When env_hold is true, the system is holding on the next decision variable!
@@ -183,15 +213,43 @@ public:
 
     // Comments by Fei: add a root_shadow and a leaf_shadow (the access from minisat to tree of shadows)
     shadow* root_shadow; // this is the shadow at the root of MCTS 
-    shadow* leaf_shadow; // this is the current active (needs state evaluation) of the MCTS
+    vec<shadow*> leaf_shadows; // these are the current active (need state evaluation) shadows of the MCTS (waiting, in the order returned)
+    ClauseArena shadow_arena; // clauses copied or learnt inside the shadow tree (shared by all shadows, chunks are released with their shadow)
+    node_pool<shadow> shadow_nodes; // memory of the shadows (declared after shadow_arena, so that shadows are destructed first)
     void reclaim_memory(shadow*);
 
+    // The replay backend of MCTS: the tree keeps statistics only, and simulations are run on this Solver and undone
+    bool    mcts_replay;  // use replay nodes instead of shadows (set before the first call of simulate())
+    int     mcts_size_lim;// the number of simulations of one MCTS (per step)
+    int     mcts_threads; // the number of threads that collect a batch of leaves together (shadow backend, batches of more than one leaf)
+    int     mcts_trees;   // the number of independent trees searched at once (shadow backend): root_shadow and those of root_ensemble
+    vec<shadow*> root_ensemble; // the roots of the other mcts_trees - 1 trees (NULL for a tree that is built again at the next simulate)
+    vec<float>   root_pi;       // the pi of root_shadow before its dirichlet noise, for the roots of root_ensemble built from it
+    bool    mcts_transpose; // a new leaf in the same state as an evaluated shadow of this search takes its evaluation (shadow backend)
+    std::unordered_map<uint64_t, shadow*> transpositions; // the evaluated shadows of this search by hash (see find_transposition)
+    eval_cache* nn_cache; // the evaluations of the states seen before, in this or other Solvers (owned by the caller, NULL for none)
+    const nn_model* nn_net; // the network that evaluates the leaves of simulate_native(prior_model) (owned by the caller, NULL for none)
+    enum { eval_none = 0, eval_caller = 1, eval_native = 2 };
+    int     mcts_evaluator; // who evaluates the leaves of the MCTS of this move: the caller of simulate() (marked by the caller), or
+                            // simulate_native(). The two do not mix in one move (reset when the state of a move is written).
+    replay* root_replay;  // this is the replay node at the root of MCTS
+    vec<replay*> leaf_replays; // these are the current active (need state evaluation) replay nodes of the MCTS
+    node_pool<replay> replay_nodes;
+
     // Comments by Fei. This is short-circuit for pickBranchLit, so I can use it as public fuction
     Lit default_pickLit() {return pickBranchLit();} 
 
     // Comments by Fei. This is the field method for simulating MCTS, 
-    int simulate(float* array, float* pi, float v);
+    int simulate(state_out array, float* pi, float v);
+    int simulate_batch(state_out array, int k, const float* pi, const float* v, bool& more); // up to k leaves per call
+    int waiting_leaves() const { return mcts_replay ? leaf_replays.size() : leaf_shadows.size(); } // the leaves whose pi and v the next call expects
+
+    // The native search: the whole MCTS of a move runs here, the leaves are evaluated by nn_net (prior_model), or by a heuristic prior
+    // (with v = 0, the value of no information). simulate() is not called in the same move (std::invalid_argument). k leaves per batch.
+    enum { prior_uniform = 0, prior_activity = 1, prior_jw = 2, prior_occurrence = 3, prior_model = 4 };
+    int simulate_native(int prior, int k = 1);  // returns the number of simulations (see mctsSimulations())
     void get_visit_count(float* array);
+    int  get_proven_action() const;             // the first action of the shortest proven line of the roots (see mcts_node::prove), or -1
 
     // Statistics: (read-only member variable)
     //
@@ -220,6 +278,11 @@ protected:
         bool operator()(const Watcher& w) const { return ca[w.cref].mark() == 1; }
     };
 
+    struct ClauseDeleted {
+        const ClauseAllocator& ca;
+        explicit ClauseDeleted(const ClauseAllocator& _ca) : ca(_ca) {}
+        bool operator()(const CRef& cr) const { return ca[cr].mark() == 1; } };
+
     struct VarOrderLt {
         const IntMap<Var, double>&  activity;
         bool operator () (Var x, Var y) const { return activity[x] > activity[y]; }
@@ -248,6 +311,9 @@ protected:
     VMap<VarData>       vardata;          // Stores reason and level for each variable.
     OccLists<Lit, vec<Watcher>, WatcherDeleted, MkIndexLit>
                         watches;          // 'watches[lit]' is a list of constraints watching 'lit' (will go there if literal becomes true).
+    OccLists<Lit, vec<CRef>, ClauseDeleted, MkIndexLit>
+                        lit_occurs;       // 'lit_occurs[lit]' is a list of the attached clauses containing 'lit'.
+    int                 num_unsat;        // Number of attached clauses with no true literal (counted in each clause, see Clause::satCount).
 
     Heap<Var,VarOrderLt>order_heap;       // A priority queue of variables ordered with respect to the variable activity.
 
@@ -283,6 +349,52 @@ protected:
     int64_t             propagation_budget; // -1 means no budget.
     bool                asynch_interrupt;
 
+    double              mcts_time_budget;   // (per move) -1 means no budget.
+    int64_t             mcts_prop_budget;   // (per move) -1 means no budget.
+    int64_t             mcts_mem_budget;    // -1 means no budget.
+    double              mcts_deadline;      // The end of the time budget of this move (see realTime()), -1 if none.
+    int64_t             mcts_prop_target;   // The end of the propagation budget of this move, -1 if none.
+    std::atomic<uint64_t> mcts_propagations;// The propagations of all simulations (by the shadows, or by replay_step).
+    std::atomic<int64_t>  shadow_bytes;     // The bytes held by the live shadows, apart from the arena (see shadow::footprint()).
+
+    // Replay search: a simulation is applied to the solver state itself, and undone afterwards
+    //
+    struct ReplayCheckpoint {
+        int      level;                   // Decision level of the real state.
+        int      trail0;                  // Number of top-level assignments of the real state.
+        int      min_level;               // Lowest level backjumped to during the simulation ('level' + 1 if none).
+        int      n_learnts;               // Number of learnt clauses of the real state.
+        int64_t  simpDB_props;
+        uint64_t propagations;            // Propagations before the simulation (those of the simulation go to mcts_propagations).
+        vec<Lit> decisions;               // Decisions of the real state (lit_Undef for a dummy level), redone after a deep backjump.
+    };
+    bool                replaying;        // TRUE while a simulation is applied (no activity bumping or phase saving).
+    ReplayCheckpoint    replay_cp;
+
+    void     replay_save      ();                                                      // Remember the real state before a simulation.
+    bool     replay_step      (Lit p);                                                 // Decide 'p' and propagate (learning from conflicts). FALSE if UNSAT.
+    void     replay_undo      ();                                                      // Restore the real state saved by 'replay_save()'.
+    shadow*  explore          (shadow* root, state_out array);                            // Run one simulation from 'root', return the leaf to evaluate (or NULL).
+    replay*  explore          (replay* root, state_out array);
+    template<class Node>
+    void     backup_leaves    (vec<Node*>& leaves, const float* pi, const float* v);      // Hand the evaluations to the waiting leaves, and back them up.
+    template<class Node>
+    void     explore_leaves   (Node* root, vec<Node*>& leaves, state_out array, int k);   // Run simulations until there are k new leaves (or no more simulations).
+    void     explore_parallel (shadow* root, vec<shadow*>& leaves, state_out array, int k); // ... with mcts_threads threads in the same tree.
+    void     explore_ensemble (state_out array, int k);                                   // ... in the mcts_trees trees at once, one thread each.
+    void     share_with_threads();                                                        // Make the Solver safe to read by the shadows of several threads.
+    shadow*  proven_root      () const;                                                   // A root (of root_shadow and root_ensemble) that is proven, or NULL.
+    template<class Node>
+    bool     searching        (const Node* root) const;                                   // Whether the search from 'root' goes on (simulations, proof, budgets).
+    void     heuristic_prior  (int prior, const uint8_t* packed, float* pi) const;        // The pi of 'prior' for a packed state (see simulate_native).
+    void     startMctsBudget  ();                                                         // Start the budgets of the search of a new move.
+    bool     withinMctsBudget () const;
+    shadow*  find_transposition(shadow* leaf);                                             // An evaluated shadow of this search in the same state as 'leaf' (or NULL).
+    bool     known_evaluation (shadow* leaf, float& v);                                   // Set the pi and v of 'leaf' from a transposition or nn_cache, if known.
+    bool     known_evaluation (replay* leaf, float& v);
+    template<class Node>
+    void     evaluate_known   (vec<Node*>& leaves, state_out array);                      // Back up the new leaves of known evaluation, and drop them from the batch.
+
     // Main internal methods:
     //
     void     insertVarOrder   (Var x);                                                 // Insert a variable in the decision order priority queue.
@@ -317,6 +429,9 @@ protected:
     bool     isRemoved        (CRef cr) const;         // Test if a clause has been removed.
     bool     locked           (const Clause& c) const; // Returns TRUE if a clause is a reason for some implication in the current state.
     bool     satisfied        (const Clause& c) const; // Returns TRUE if a clause is satisfied in the current state.
+    bool     isSatisfied      (CRef cr) const;         // Same as 'satisfied()' for an attached clause, but O(1) (by its satisfaction counter).
+    void     satCountUp       (Lit p);                 // 'p' became true: count it in the clauses containing it.
+    void     satCountDown     (Lit p);                 // 'p' is no longer true: uncount it in the clauses containing it.
 
     // Misc:
     //
@@ -389,6 +504,15 @@ inline bool     Solver::addClause       (Lit p, Lit q, Lit r)   { add_tmp.clear(
 inline bool     Solver::addClause       (Lit p, Lit q, Lit r, Lit s){ add_tmp.clear(); add_tmp.push(p); add_tmp.push(q); add_tmp.push(r); add_tmp.push(s); return addClause_(add_tmp); }
 
 inline bool     Solver::isRemoved       (CRef cr)         const { return ca[cr].mark() == 1; }
+inline bool     Solver::isSatisfied     (CRef cr)         const { return ca[cr].satCount() > 0; }
+inline void     Solver::satCountUp      (Lit p) {
+    const vec<CRef>& cs = lit_occurs.lookup(p);
+    for (int i = 0; i < cs.size(); i++)
+        if (ca[cs[i]].satCount()++ == 0) num_unsat--; }
+inline void     Solver::satCountDown    (Lit p) {
+    const vec<CRef>& cs = lit_occurs.lookup(p);
+    for (int i = 0; i < cs.size(); i++)
+        if (--ca[cs[i]].satCount() == 0) num_unsat++; }
 inline bool     Solver::locked          (const Clause& c) const { return value(c[0]) == l_True && reason(var(c[0])) != CRef_Undef && ca.lea(reason(var(c[0]))) == &c; }
 inline void     Solver::newDecisionLevel()                      { trail_lim.push(trail.size()); }
 
@@ -402,6 +526,7 @@ inline int      Solver::nAssigns      ()      const   { return trail.size(); }
 inline int      Solver::nClauses      ()      const   { return num_clauses; }
 inline int      Solver::nLearnts      ()      const   { return num_learnts; }
 inline int      Solver::nVars         ()      const   { return next_var; }
+inline int      Solver::nUnsat        ()      const   { return num_unsat; }
 // TODO: nFreeVars() is not quite correct, try to calculate right instead of adapting it like below:
 inline int      Solver::nFreeVars     ()      const   { return (int)dec_vars - (trail_lim.size() == 0 ? trail.size() : trail_lim[0]); }
 inline void     Solver::setPolarity   (Var v, lbool b){ user_pol[v] = b; }
@@ -418,6 +543,10 @@ inline void     Solver::setPropBudget(int64_t x){ propagation_budget = propagati
 inline void     Solver::interrupt(){ asynch_interrupt = true; }
 inline void     Solver::clearInterrupt(){ asynch_interrupt = false; }
 inline void     Solver::budgetOff(){ conflict_budget = propagation_budget = -1; }
+inline void     Solver::setMctsTimeBudget(double seconds){ mcts_time_budget = seconds; }
+inline void     Solver::setMctsPropBudget(int64_t x){ mcts_prop_budget = x; }
+inline void     Solver::setMctsMemBudget (int64_t bytes){ mcts_mem_budget = bytes; }
+inline void     Solver::mctsBudgetOff(){ mcts_time_budget = -1; mcts_prop_budget = mcts_mem_budget = -1; }
 inline bool     Solver::withinBudget() const {
     return !asynch_interrupt &&
            (conflict_budget    < 0 || conflicts < (uint64_t)conflict_budget) &&
@@ -434,11 +563,12 @@ inline bool     Solver::solve         (const vec<Lit>& assumps){ budgetOff(); as
 inline lbool    Solver::solveLimited  (const vec<Lit>& assumps){ return solve_(); }
 inline bool     Solver::okay          ()      const   { return ok; }
 
-inline ClauseIterator Solver::clausesBegin() const { return ClauseIterator(ca, &clauses[0]); }
-inline ClauseIterator Solver::clausesEnd  () const { return ClauseIterator(ca, &clauses[clauses.size()]); }
-inline TrailIterator  Solver::trailBegin  () const { return TrailIterator(&trail[0]); }
+// (the ends are taken from the first element: operator[] asserts an index within the vec)
+inline ClauseIterator Solver::clausesBegin() const { return ClauseIterator(ca, clauses.size() == 0 ? NULL : &clauses[0]); }
+inline ClauseIterator Solver::clausesEnd  () const { return ClauseIterator(ca, clauses.size() == 0 ? NULL : &clauses[0] + clauses.size()); }
+inline TrailIterator  Solver::trailBegin  () const { return TrailIterator(trail.size() == 0 ? NULL : &trail[0]); }
 inline TrailIterator  Solver::trailEnd    () const { 
-    return TrailIterator(&trail[decisionLevel() == 0 ? trail.size() : trail_lim[0]]); }
+    return TrailIterator(trail.size() == 0 ? NULL : &trail[0] + (decisionLevel() == 0 ? trail.size() : trail_lim[0])); }
 
 inline void     Solver::toDimacs     (const char* file){ vec<Lit> as; toDimacs(file, as); }
 inline void     Solver::toDimacs     (const char* file, Lit p){ vec<Lit> as; as.push(p); toDimacs(file, as); }
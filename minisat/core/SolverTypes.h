@@ -23,6 +23,8 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #define Minisat_SolverTypes_h
 
 #include <assert.h>
+#include <atomic>
+#include <mutex>
 
 #include "minisat/mtl/IntTypes.h"
 #include "minisat/mtl/Alg.h"
@@ -143,18 +145,21 @@ class Clause {
         unsigned learnt    : 1;
         unsigned has_extra : 1;
         unsigned reloced   : 1;
-        unsigned size      : 27; 
+        unsigned has_count : 1;
+        unsigned size      : 26; 
     } header;
-    union { Lit lit; float act; uint32_t abs; CRef rel; } data[0];
+    union { Lit lit; float act; uint32_t abs; CRef rel; int count; } data[0];
 
     friend class ClauseAllocator;
+    friend class ClauseArena;
 
     // NOTE: This constructor cannot be used directly (doesn't allocate enough memory).
-    Clause(const vec<Lit>& ps, bool use_extra, bool learnt) {
+    Clause(const vec<Lit>& ps, bool use_extra, bool learnt, bool use_count) {
         header.mark      = 0;
         header.learnt    = learnt;
         header.has_extra = use_extra;
         header.reloced   = 0;
+        header.has_count = use_count;
         header.size      = ps.size();
 
         for (int i = 0; i < ps.size(); i++) 
@@ -166,12 +171,15 @@ class Clause {
             else
                 calcAbstraction();
         }
+        if (header.has_count)
+            data[header.size + header.has_extra].count = 0;
     }
 
     // NOTE: This constructor cannot be used directly (doesn't allocate enough memory).
-    Clause(const Clause& from, bool use_extra){
+    Clause(const Clause& from, bool use_extra, bool use_count){
         header           = from.header;
         header.has_extra = use_extra;   // NOTE: the copied clause may lose the extra field.
+        header.has_count = use_count;   // NOTE: ... and the count field.
 
         for (int i = 0; i < from.size(); i++)
             data[i].lit = from[i];
@@ -182,6 +190,8 @@ class Clause {
             else 
                 data[header.size].abs = from.data[header.size].abs;
         }
+        if (header.has_count)
+            data[header.size + header.has_extra].count = from.has_count() ? from.satCount() : 0;
     }
 
 public:
@@ -195,10 +205,13 @@ public:
 
 
     int          size        ()      const   { return header.size; }
-    void         shrink      (int i)         { assert(i <= size()); if (header.has_extra) data[header.size-i] = data[header.size]; header.size -= i; }
+    void         shrink      (int i)         { assert(i <= size());
+                                               for (int k = 0; k < (int)(header.has_extra + header.has_count); k++) data[header.size-i+k] = data[header.size+k];
+                                               header.size -= i; }
     void         pop         ()              { shrink(1); }
     bool         learnt      ()      const   { return header.learnt; }
     bool         has_extra   ()      const   { return header.has_extra; }
+    bool         has_count   ()      const   { return header.has_count; }
     uint32_t     mark        ()      const   { return header.mark; }
     void         mark        (uint32_t m)    { header.mark = m; }
     const Lit&   last        ()      const   { return data[header.size-1].lit; }
@@ -218,6 +231,10 @@ public:
     float&       activity    ()              { assert(header.has_extra); return data[header.size].act; }
     uint32_t     abstraction () const        { assert(header.has_extra); return data[header.size].abs; }
 
+    // The number of true literals of a clause of the Solver, while it is attached (see Solver::attachClause):
+    int          satCount    () const        { assert(header.has_count); return data[header.size + header.has_extra].count; }
+    int&         satCount    ()              { assert(header.has_count); return data[header.size + header.has_extra].count; }
+
     Lit          subsumes    (const Clause& other) const;
     void         strengthen  (Lit p);
 };
@@ -225,16 +242,19 @@ public:
 
 //=================================================================================================
 // ClauseAllocator -- a simple class for allocating memory for clauses:
+//
+// Its clauses (those of a Solver) have a count field after the extra field, for the number of true literals (see
+// Clause::satCount). The copies of them in a ClauseArena have none.
 
 const CRef CRef_Undef = RegionAllocator<uint32_t>::Ref_Undef;
 class ClauseAllocator
 {
     RegionAllocator<uint32_t> ra;
 
-    static uint32_t clauseWord32Size(int size, bool has_extra){
-        return (sizeof(Clause) + (sizeof(Lit) * (size + (int)has_extra))) / sizeof(uint32_t); }
-
  public:
+    static uint32_t clauseWord32Size(int size, bool has_extra, bool has_count){
+        return (sizeof(Clause) + (sizeof(Lit) * (size + (int)has_extra + (int)has_count))) / sizeof(uint32_t); }
+
     enum { Unit_Size = RegionAllocator<uint32_t>::Unit_Size };
 
     bool extra_clause_field;
@@ -247,19 +267,30 @@ class ClauseAllocator
         ra.moveTo(to.ra); 
     }
 
+    void copyTo(ClauseAllocator& to) const {  // (the CRefs of the copy are those of this allocator)
+        to.extra_clause_field = extra_clause_field;
+        ra.copyTo(to.ra);
+    }
+
+    uint64_t reserve(uint64_t clauses, uint64_t literals) {  // room for that many more (problem) clauses, of that many literals in
+        uint64_t words = clauses * clauseWord32Size(0, extra_clause_field, true) + literals;  // all (returns the words reserved)
+        ra.reserve(words);
+        return words;
+    }
+
     CRef alloc(const vec<Lit>& ps, bool learnt = false) {
         assert(sizeof(Lit)      == sizeof(uint32_t));
         assert(sizeof(float)    == sizeof(uint32_t));
         bool use_extra = learnt | extra_clause_field;
-        CRef cid       = ra.alloc(clauseWord32Size(ps.size(), use_extra));
-        new (lea(cid)) Clause(ps, use_extra, learnt);
+        CRef cid       = ra.alloc(clauseWord32Size(ps.size(), use_extra, true));
+        new (lea(cid)) Clause(ps, use_extra, learnt, true);
         return cid;
     }
 
     CRef alloc(const Clause& from) {
         bool use_extra = from.learnt() | extra_clause_field;
-        CRef cid       = ra.alloc(clauseWord32Size(from.size(), use_extra));
-        new (lea(cid)) Clause(from, use_extra);
+        CRef cid       = ra.alloc(clauseWord32Size(from.size(), use_extra, true));
+        new (lea(cid)) Clause(from, use_extra, true);
         return cid;
     }
 
@@ -276,7 +307,7 @@ class ClauseAllocator
     void free(CRef cid)
     {
         Clause& c = operator[](cid);
-        ra.free(clauseWord32Size(c.size(), c.has_extra()));
+        ra.free(clauseWord32Size(c.size(), c.has_extra(), c.has_count()));
     }
 
     void reloc(CRef& cr, ClauseAllocator& to)
@@ -290,6 +321,160 @@ class ClauseAllocator
     }
 };
 
+//=================================================================================================
+// ClauseArena -- a chunked clause allocator shared by many owners (e.g. the nodes of a shadow tree):
+//
+// Memory is handed out in small chunks. Each owner bump-allocates its clauses inside the chunks it
+// holds, and gives all of them back at once with 'release()'. A reference encodes the chunk index
+// and the offset within the chunk, so it stays valid while other owners allocate, and an owner
+// only ever pins as much memory as the clauses it actually copied.
+//
+// Owners may allocate from several threads at once (one owner per thread). The chunks are found through
+// a two level directory of pages that never moves, so clauses can be read without a lock while other
+// owners allocate; only getting and giving back chunks takes the lock.
+
+class ClauseArena
+{
+ public:
+    enum { Chunk_Bits = 8, Chunk_Words = 1 << Chunk_Bits };
+
+    // The chunks held by one owner; the last one is the one currently being filled.
+    struct Chunks {
+        vec<uint32_t> held;
+        uint32_t      top;    // Words used in the last held chunk.
+        uint32_t      used;   // Words of the clauses allocated by this owner, and of those freed since (given back on 'release()').
+        uint32_t      wasted;
+        Chunks() : top(Chunk_Words), used(0), wasted(0) {}
+    };
+
+ private:
+    enum { Page_Bits = 12, Page_Chunks = 1 << Page_Bits, Max_Pages = 1 << (32 - Chunk_Bits - Page_Bits), Size_Classes = 32 };
+    uint32_t**     pages[Max_Pages]; // Chunk memory, indexed by the upper bits of a reference (pages allocated on demand).
+    uint32_t       n_chunks;
+    vec<uint32_t>  chunk_cap;   // Capacity (in words) of each chunk; only larger than 'Chunk_Words' for huge clauses.
+    vec<uint32_t>  free_chunks[Size_Classes]; // Chunks currently not held by any owner, by the class of their capacity (see 'sizeClass()').
+    std::atomic<uint32_t> sz;      // Words of the clauses of the owners (the chunks held may be larger).
+    std::atomic<uint32_t> wasted_; // Words of those clauses that are freed.
+    std::atomic<uint64_t> held_;   // Words of the chunks held by the owners (their whole capacity).
+    mutable std::mutex    lock; // Guards n_chunks, chunk_cap, free_chunks and new pages.
+
+    uint32_t*& chunk(uint32_t c) const { return pages[c >> Page_Bits][c & (Page_Chunks - 1)]; }
+
+    // Class k holds the capacities 2^k .. 2^(k+1)-1 (all at least 'Chunk_Words', so the small classes stay empty):
+    static int sizeClass(uint32_t words){ int k = 0; while (words >>= 1) k++; return k; }
+
+    uint32_t newChunk(uint32_t words){
+        std::lock_guard<std::mutex> guard(lock);
+        uint32_t c = takeChunk(words);
+        held_ += chunk_cap[c];
+        return c;
+    }
+
+    uint32_t takeChunk(uint32_t words){  // (with the lock held)
+        // A chunk of the class of 'words' that is large enough, else any chunk of the smallest larger class (so a standard
+        // chunk is never served from the chunk of a huge clause while a standard one is free):
+        int k = sizeClass(words);
+        for (int i = free_chunks[k].size() - 1; i >= 0; i--)
+            if (chunk_cap[free_chunks[k][i]] >= words){
+                uint32_t c = free_chunks[k][i];
+                free_chunks[k][i] = free_chunks[k].last();
+                free_chunks[k].pop();
+                return c; }
+        for (k++; k < Size_Classes; k++)
+            if (free_chunks[k].size() > 0){
+                uint32_t c = free_chunks[k].last();
+                free_chunks[k].pop();
+                return c; }
+        if (n_chunks >= (CRef_Undef >> Chunk_Bits))
+            throw OutOfMemoryException();
+        uint32_t cap = words > (uint32_t)Chunk_Words ? words : (uint32_t)Chunk_Words;
+        if (pages[n_chunks >> Page_Bits] == NULL)
+            pages[n_chunks >> Page_Bits] = (uint32_t**)xrealloc(NULL, sizeof(uint32_t*) * Page_Chunks);
+        chunk(n_chunks) = (uint32_t*)xrealloc(NULL, sizeof(uint32_t) * cap);
+        chunk_cap.push(cap);
+        return n_chunks++;
+    }
+
+    CRef reserve(Chunks& owner, uint32_t words){
+        // Clauses that do not fit in a standard chunk get a chunk of their own (always at offset 0):
+        if (words > (uint32_t)Chunk_Words){
+            uint32_t c = newChunk(words);
+            if (owner.held.size() == 0) owner.held.push(c);
+            else{ owner.held.push(owner.held.last()); owner.held[owner.held.size() - 2] = c; }
+            owner.used += words;
+            sz         += words;
+            return c << Chunk_Bits; }
+
+        if (owner.top + words > (uint32_t)Chunk_Words){
+            owner.held.push(newChunk(Chunk_Words));
+            owner.top = 0; }
+        CRef cr = (owner.held.last() << Chunk_Bits) | owner.top;
+        owner.top  += words;
+        owner.used += words;
+        sz         += words;
+        return cr;
+    }
+
+ public:
+    bool extra_clause_field;
+
+    ClauseArena() : pages(), n_chunks(0), sz(0), wasted_(0), held_(0), extra_clause_field(false){}
+    ~ClauseArena(){
+        for (uint32_t i = 0; i < n_chunks; i++)
+            ::free(chunk(i));
+        for (int i = 0; i < Max_Pages; i++)
+            ::free(pages[i]);
+    }
+
+    CRef alloc(Chunks& owner, const vec<Lit>& ps, bool learnt = false){
+        bool use_extra = learnt | extra_clause_field;
+        CRef cid       = reserve(owner, ClauseAllocator::clauseWord32Size(ps.size(), use_extra, false));
+        new (lea(cid)) Clause(ps, use_extra, learnt, false);
+        return cid;
+    }
+
+    CRef alloc(Chunks& owner, const Clause& from){
+        bool use_extra = from.learnt() | extra_clause_field;
+        CRef cid       = reserve(owner, ClauseAllocator::clauseWord32Size(from.size(), use_extra, false));
+        new (lea(cid)) Clause(from, use_extra, false);
+        return cid;
+    }
+
+    // Give back every chunk held by 'owner' (and take its clauses, freed or not, out of 'size()' and 'wasted()'):
+    void release(Chunks& owner){
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            uint64_t words = 0;
+            for (int i = 0; i < owner.held.size(); i++){
+                free_chunks[sizeClass(chunk_cap[owner.held[i]])].push(owner.held[i]);
+                words += chunk_cap[owner.held[i]]; }
+            held_ -= words;
+        }
+        sz      -= owner.used;
+        wasted_ -= owner.wasted;
+        owner.held.clear();
+        owner.top = Chunk_Words;
+        owner.used = owner.wasted = 0;
+    }
+
+    // Free a clause of 'owner' (its words are given back with the chunks of the owner):
+    void free(Chunks& owner, CRef cid){
+        Clause& c = operator[](cid);
+        uint32_t words = ClauseAllocator::clauseWord32Size(c.size(), c.has_extra(), c.has_count());
+        owner.wasted += words;
+        wasted_      += words;
+    }
+
+    uint32_t size      () const      { return sz; }
+    uint32_t wasted    () const      { return wasted_; }
+    uint64_t bytes     () const      { return held_ * sizeof(uint32_t); }  // (the memory of the chunks held now, not of those kept for reuse)
+
+    Clause&       operator[](CRef r)         { return *lea(r); }
+    const Clause& operator[](CRef r) const   { return *lea(r); }
+    Clause*       lea       (CRef r)         { assert(pages[r >> (Chunk_Bits + Page_Bits)] != NULL); return (Clause*)(chunk(r >> Chunk_Bits) + (r & (Chunk_Words - 1))); }
+    const Clause* lea       (CRef r) const   { assert(pages[r >> (Chunk_Bits + Page_Bits)] != NULL); return (Clause*)(chunk(r >> Chunk_Bits) + (r & (Chunk_Words - 1))); }
+};
+
 //=================================================================================================
 // Simple iterator classes (for iterating over clauses and top-level assignments):
 
@@ -357,6 +542,12 @@ class OccLists
         dirty  .clear(free);
         dirties.clear(free);
     }
+
+    void  copyTo(OccLists& to) const {   // (the lists of 'to' keep their own 'deleted')
+        occs   .deepCopyTo(to.occs);
+        dirty  .copyTo(to.dirty);
+        dirties.copyTo(to.dirties);
+    }
 };
 
 
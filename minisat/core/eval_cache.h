@@ -0,0 +1,140 @@
+#ifndef Minisat_eval_cache_h
+#define Minisat_eval_cache_h
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <mutex>
+
+#include "minisat/mtl/Vec.h"
+
+namespace Minisat {
+
+// eval_cache -- the evaluations (pi and v) that the network gave to the states it has seen, by the key of the state (see state_writer)
+//
+// The same state comes back in later moves, and in later episodes of the same problem (the repeat^n mode of MiniSATEnv), so a new MCTS
+// leaf whose state is in the cache is backed up at once, instead of being returned for evaluation (see Solver::evaluate_known).
+// The cache holds at most 'capacity' states, and drops the least recently used one to make room. The entries are kept in arrays
+// (linked in the order of use), and found by an open addressing table of at least two slots per entry (made at the first insert), so
+// a full cache does not allocate. The first insert fixes the number of actions of the entries.
+// One cache may be shared by the Solvers of one network (with the same state dims), and used by several threads at once.
+class eval_cache {
+public:
+    explicit eval_cache(int capacity) : cap(capacity), nact(0), head(-1), tail(-1), n_hits(0), n_misses(0) { assert(capacity > 0); }
+
+    bool lookup(uint64_t key, int nact, float* pi, float& v);        // copy the evaluation of the state of key to pi and v, if there is one
+    void insert(uint64_t key, int nact, const float* pi, float v);   // add (or renew) the evaluation of the state of key
+    void clear ();                                                   // drop all entries (e.g. when the network has changed)
+
+    int      size    () const { std::lock_guard<std::mutex> guard(lock); return entries.size(); }
+    int      capacity() const { return cap; }
+    uint64_t hits    () const { std::lock_guard<std::mutex> guard(lock); return n_hits; }
+    uint64_t misses  () const { std::lock_guard<std::mutex> guard(lock); return n_misses; }
+
+private:
+    struct entry { uint64_t key; float v; int prev, next; };
+
+    int        cap;
+    int        nact;
+    vec<entry> entries;
+    vec<float> pis;                               // the pi of entries[i] is at [i * nact, (i + 1) * nact)
+    vec<int>   slots;                             // key -> entry, by linear probing from slot home(key) (-1 for an empty slot)
+    int        head, tail;                        // the most and the least recently used entry (-1 if there is none)
+    uint64_t   n_hits, n_misses;
+    mutable std::mutex lock;                      // guards all of the above
+
+    void unlink    (int i);
+    void push_front(int i);
+    int  home      (uint64_t key) const { return (int)(key ^ key >> 32) & (slots.size() - 1); } // (the keys are hashes already)
+    int  find_slot (uint64_t key) const;          // the slot of key, or the empty slot where it goes
+    void erase_slot(int s);
+};
+
+inline void eval_cache::unlink(int i) {
+    entry& e = entries[i];
+    if (e.prev >= 0) entries[e.prev].next = e.next; else head = e.next;
+    if (e.next >= 0) entries[e.next].prev = e.prev; else tail = e.prev;
+}
+
+inline void eval_cache::push_front(int i) {
+    entries[i].prev = -1;
+    entries[i].next = head;
+    if (head >= 0) entries[head].prev = i;
+    head = i;
+    if (tail < 0) tail = i;
+}
+
+inline int eval_cache::find_slot(uint64_t key) const {
+    int s = home(key);
+    while (slots[s] >= 0 && entries[slots[s]].key != key) s = (s + 1) & (slots.size() - 1);
+    return s;
+}
+
+// empty slot s, and move back the entries after it that can not be found past the empty slot any more (so no other key is lost)
+inline void eval_cache::erase_slot(int s) {
+    int mask = slots.size() - 1;
+    slots[s] = -1;
+    for (int j = (s + 1) & mask; slots[j] >= 0; j = (j + 1) & mask) {
+        int h = home(entries[slots[j]].key);
+        if (((j - h) & mask) >= ((j - s) & mask)) {  // (h is not in (s, j], cyclically: the entry at j belongs at s or before)
+            slots[s] = slots[j];
+            slots[j] = -1;
+            s = j;
+        }
+    }
+}
+
+inline bool eval_cache::lookup(uint64_t key, int n, float* pi, float& v) {
+    std::lock_guard<std::mutex> guard(lock);
+    int i = n == nact && slots.size() > 0 ? slots[find_slot(key)] : -1;
+    if (i < 0) { n_misses++; return false; }
+    memcpy(pi, &pis[i * nact], nact * sizeof(float));
+    v = entries[i].v;
+    unlink(i);
+    push_front(i);
+    n_hits++;
+    return true;
+}
+
+inline void eval_cache::insert(uint64_t key, int n, const float* pi, float v) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (nact == 0) nact = n;
+    if (n != nact) return;                        // (the keys of other dims never match the entries either)
+    if (slots.size() == 0) {
+        int size = 2;
+        while (size / 2 < cap) size *= 2;
+        slots.growTo(size, -1);
+    }
+    int s = find_slot(key);
+    int i = slots[s];
+    if (i >= 0)
+        unlink(i);
+    else if (entries.size() < cap) {
+        i = entries.size();
+        entries.push();
+        pis.growTo((i + 1) * nact);
+        slots[s] = i;
+    } else {                                      // reuse the least recently used entry
+        i = tail;
+        unlink(i);
+        erase_slot(find_slot(entries[i].key));
+        slots[find_slot(key)] = i;
+    }
+    entries[i].key = key;
+    entries[i].v   = v;
+    memcpy(&pis[i * nact], pi, nact * sizeof(float));
+    push_front(i);
+}
+
+inline void eval_cache::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    entries.clear();
+    pis.clear();
+    slots.clear();
+    head = tail = -1;
+    nact = 0;
+}
+
+}
+
+#endif
@@ -0,0 +1,263 @@
+#ifndef Minisat_mcts_h
+#define Minisat_mcts_h
+
+#include <assert.h>
+#include <math.h>
+#include <limits.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#include "minisat/core/Const.h"
+
+namespace Minisat {
+
+// mcts_node -- the statistics and the selection rule of one node in the Monte Carlo search tree
+//
+// This is shared by the two search backends: shadow (every node keeps the difference of its state to
+// its parent) and replay (nodes keep only these statistics, and the state is recomputed on the Solver
+// for every simulation). 'Node' is the derived class, so that parent and childern are typed pointers.
+// The per action arrays have nact entries (the number of actions of the Solver the tree belongs to, see state_dims),
+// and are laid out right after the node itself: a node must be allocated from a node_pool whose tail is tail_bytes(nact).
+//
+// A leaf whose state has been written out is 'waiting' until its pi and v come back (see Solver::backup_leaves).
+// With a batch of waiting leaves, each edge on their paths carries a virtual loss (vloss), so that the next
+// selections of the same batch prefer other paths.
+//
+// Several threads may select and expand in the same tree at once (see Solver::explore_parallel). The counts that
+// selections change (nn, sumN, vloss), the childern pointers (a new child is claimed by a compare and swap) and done
+// are atomic for that. pi, qu, valid and the rest only change between parallel batches, or before a new child is shared.
+//
+// A child in done has stepped into a finished state (solved, or proven UNSAT): the episode ends there, which is as good as it gets
+// for the agent (every step costs the same reward). A node is proven (MCTS-Solver) when its shortest line to a finished state is
+// known: at once when a child is done (one step), and otherwise only when no other child can be shorter than its shortest proven
+// one (see shortest_line). Selection passes over proven childern, and the search of a proven root stops at once: its shortest
+// line is proven_action. The replay backend proves the root only (the states below it may differ from one visit to the next).
+template<class Node>
+class mcts_node {
+public:
+    Node* parent;                        // this points to the parent node (will be null if this is the root node)
+    int action;                          // the index of this node in the childern of its parent (-1 for the root node)
+    int nact;                            // the number of actions (the same in the whole tree)
+    std::atomic<Node*>* childern;        // this is an array of pointers to all the childern of this node (could be null if childern not visited yet)
+    float* pi;                           // this is an array of pi values (initial visiting probality for MCTS simulation)
+    float* qu;                           // this is an array of qu values (total expect score for MCTS simulation)
+    std::atomic<int>* nn;                // this is an array of nn values (total visit count for each childern in MCTS simulation)
+    std::atomic<bool>* done;             // this is an array to label if a child branch leads to finished state
+    std::atomic<int> sumN;               // this is the total number of MCTS simulations run from this node (sum of nn)
+    bool* valid;                         // this array marks all valid steps (for simulation) (constructed when the state is generated)
+    bool valid_is_initialized;
+    bool dirichlet_noise_has_been_added; //
+    bool waiting;                        // the state of this node is written out, and waits for its pi and v
+    float v_eval;                        // the v of the evaluation of this node (set by backup)
+    uint64_t state_key;                  // the key of the state written for this node (see state_writer::key), for the eval_cache
+    std::atomic<int>* vloss;             // this is an array of the number of waiting leaves below each child (each counts as a virtual loss)
+    std::atomic<bool> proven;            // the shortest line from this node to a finished state is known (see prove())
+    std::atomic<int> proven_depth;       // the number of steps of that line (set before proven)
+
+    mcts_node(Node* from, int nact, int action);
+    static size_t tail_bytes(int nact);  // the bytes of the per action arrays of a node (allocated after it by its node_pool)
+    void  attach_arrays();               // point the arrays at the memory after the Node (called first in the constructors of Node)
+
+    int   pick_child();                  // this function picks the child to simulate (also counts the visit), and returns its index
+    void  add_dirichlet_noise();         // add the dirichlet noise to the pi of the root node (once, done by the first pick_child())
+    void  get_visit_count(float* count); // this function writes the nn array to array argument
+    Node* detach_child(int action);      // this function removes the child at index "action" from this node, and returns it as a root
+
+    void  add_vloss();                   // a new waiting leaf: add a virtual loss on the path from the root to this node
+    void  backup(float v);               // the value v of this waiting leaf: back it up the path to the root, and remove the virtual loss
+    void  revert_visit();                // undo the visit counts of a selection that stopped at this (waiting) node
+    void  undo_path(int pick, int visits, int losses); // subtract visits and virtual losses from the child at pick, and on the path up to the root
+    void  prove();                       // a child of this node was stepped (into a finished state, or expanded): mark this node and
+                                         // its ancestors proven, up to the first one whose shortest line is not known
+    int   shortest_line() const;         // the steps of the shortest line to a finished state, as far as the childern tell (-1 if unknown)
+    int   proven_action() const;         // the first action of the shortest line of a proven node (-1 if it is not proven)
+};
+
+template<class Node>
+mcts_node<Node>::mcts_node(Node* from, int nact, int action) :
+    parent(from),
+    action(action),
+    nact(nact),
+    sumN(0),
+    valid_is_initialized(false),
+    dirichlet_noise_has_been_added(false),
+    waiting(false),
+    v_eval(0.0),
+    state_key(0),
+    proven(false),
+    proven_depth(0)
+{}
+
+// (the Node is fully laid out only in its own constructor, hence not here in the one of mcts_node)
+template<class Node>
+void mcts_node<Node>::attach_arrays() {
+    // the arrays, from the largest entries to the smallest (so each is aligned): see tail_bytes()
+    char* tail = reinterpret_cast<char*>(static_cast<Node*>(this)) + sizeof(Node);
+    childern = reinterpret_cast<std::atomic<Node*>*>(tail); tail += nact * sizeof(std::atomic<Node*>);
+    pi       = reinterpret_cast<float*>(tail);              tail += nact * sizeof(float);
+    qu       = reinterpret_cast<float*>(tail);              tail += nact * sizeof(float);
+    nn       = reinterpret_cast<std::atomic<int>*>(tail);   tail += nact * sizeof(std::atomic<int>);
+    vloss    = reinterpret_cast<std::atomic<int>*>(tail);   tail += nact * sizeof(std::atomic<int>);
+    done     = reinterpret_cast<std::atomic<bool>*>(tail);  tail += nact * sizeof(std::atomic<bool>);
+    valid    = reinterpret_cast<bool*>(tail);
+    for (int i = 0; i < nact; i++) {
+        new (&childern[i]) std::atomic<Node*>(NULL);
+        pi[i] = 0.0;
+        qu[i] = 0.0;
+        new (&nn[i]) std::atomic<int>(0);
+        new (&vloss[i]) std::atomic<int>(0);
+        new (&done[i]) std::atomic<bool>(false);
+        valid[i] = false;
+    }
+}
+
+template<class Node>
+size_t mcts_node<Node>::tail_bytes(int nact) {
+    static_assert(sizeof(Node) % alignof(std::atomic<Node*>) == 0, "the arrays after a node must be aligned");
+    return nact * (sizeof(std::atomic<Node*>) + 2 * sizeof(float) + 2 * sizeof(std::atomic<int>) + sizeof(std::atomic<bool>) + sizeof(bool));
+}
+
+// The key logic is picking the best childern index, which is calculated based on nn, pi, qu and sumN
+// The logic also prevent picking variables whose values are already assigned OR who is not in the state (check "valid" array)
+// if a child index is pick, update the nn and sumN, but the qu (values) has to wait until next simulation call from Solver (need neural net evaluation)
+// The childern whose line is settled (finished, or proven: see prove) are passed over, unless all of them are
+// NOTE: the counts are read once each, as other threads may be changing them (see explore_parallel)
+template<class Node>
+int mcts_node<Node>::pick_child() {
+    // if this is the root node, and the dirichlet noise has not been added to the pi, add dirichlet noise
+    if (parent == NULL) add_dirichlet_noise();
+
+    int pick = -1; float pick_val = 0;
+    int total = sumN;
+    for (int pass = 0; pick < 0 && pass < 2; pass++)
+        for (int i = 0; i < nact; i++) {
+            if (!valid[i]) continue; // IMPORTANT: only check Lit that exists in current state
+            if (pass == 0) {
+                Node* child = childern[i];
+                if (done[i] || (child != NULL && child -> proven)) continue;
+            }
+            int   n   = nn[i];
+            float uu  = Hyper_Const::c_act * pi[i] * sqrt(total) / (1 + n);
+            float val = n == 0? uu : uu + (qu[i] - Hyper_Const::virtual_loss * vloss[i]) / n;
+            if (pick == -1 || val > pick_val) {
+                pick = i; pick_val = val;
+            }
+        }
+    assert (pick >= 0 && "failed to pick a good action for simulation");
+
+    nn[pick]++; sumN++;
+    return pick;
+}
+
+template<class Node>
+void mcts_node<Node>::add_dirichlet_noise() {
+    if (dirichlet_noise_has_been_added) return;
+    double di[Hyper_Const::max_nact];
+    Hyper_Const::generate_dirichlet(di, nact);
+    for (int i = 0; i < nact; i++) {
+        pi[i] = pi[i] * 0.75f + ((float)di[i]) * 0.25f;
+    }
+    dirichlet_noise_has_been_added = true;
+}
+
+// this function writes nn (visit count) to array (some numpy array provided by RL algorithm)
+template<class Node>
+void mcts_node<Node>::get_visit_count(float* array) {
+    for (int i = 0; i < nact; i++)
+        array[i] = nn[i];
+}
+
+// the connection between this node and the child at index action is removed
+// The pointer to the child is returned (NULL if the child doesn't exist because it is in a finished state)
+template<class Node>
+Node* mcts_node<Node>::detach_child(int action) {
+    Node* temp = childern[action];
+    if (temp == NULL) return NULL;
+    temp -> parent = NULL;
+    temp -> action = -1;
+    childern[action] = NULL;
+    return temp;
+}
+
+template<class Node>
+void mcts_node<Node>::add_vloss() {
+    for (mcts_node* n = this; n -> parent != NULL; n = n -> parent)
+        n -> parent -> vloss[n -> action]++;
+}
+
+template<class Node>
+void mcts_node<Node>::backup(float v) {
+    v_eval = v;
+    for (mcts_node* n = this; n -> parent != NULL; n = n -> parent) {
+        n -> parent -> qu[n -> action] += v;
+        if (waiting) n -> parent -> vloss[n -> action]--;
+    }
+    waiting = false;
+}
+
+template<class Node>
+void mcts_node<Node>::revert_visit() {
+    if (parent != NULL) parent -> undo_path(action, 1, 0);
+}
+
+template<class Node>
+void mcts_node<Node>::undo_path(int pick, int visits, int losses) {
+    for (mcts_node* n = this; n != NULL; pick = n -> action, n = n -> parent) {
+        n -> nn[pick] -= visits;
+        n -> sumN -= visits;
+        n -> vloss[pick] -= losses;
+    }
+}
+
+// With several threads, a child that is claimed but not stepped yet counts as expanded, so a line may be proven one step too long
+// for a while: the proof of the node is made shorter when the step of that child proves it again. A proof may also be missed when
+// two childern are proven at once, which only means that the search goes on.
+template<class Node>
+void mcts_node<Node>::prove() {
+    for (mcts_node* n = this; n != NULL; n = n -> parent) {
+        int depth = n -> shortest_line();
+        if (depth < 0 || (n -> proven && depth >= n -> proven_depth)) break;
+        n -> proven_depth = depth;
+        n -> proven = true;
+    }
+}
+
+// a finished child is one step, which no line beats. Else the shortest proven child is the best line only if no other child can be
+// shorter: a child that is not expanded yet may be finished itself, and one that is expanded (not finished, nor proven) takes at least
+// one more step, so the shortest proven child must be one step from its finished state, with every other child expanded
+template<class Node>
+int mcts_node<Node>::shortest_line() const {
+    int best = INT_MAX, bound = INT_MAX; // (the fewest steps of a proven child, and the fewest that a child which is not proven might take)
+    for (int i = 0; i < nact; i++) {
+        if (!valid[i]) continue;
+        if (done[i]) return 1;
+        Node* child = childern[i];
+        if (child != NULL && child -> proven) best = std::min(best, (int)child -> proven_depth);
+        else                                  bound = std::min(bound, child == NULL ? 0 : 1);
+    }
+    if (best == INT_MAX || bound < best) return -1;
+    return best + 1;
+}
+
+// a finished child (one step), else the proven child of the shortest line (the most visited of them, for a tie)
+template<class Node>
+int mcts_node<Node>::proven_action() const {
+    if (!proven) return -1;
+    int best = -1;
+    for (int i = 0; i < nact; i++) {
+        if (!valid[i]) continue;
+        if (done[i]) return i;
+        Node* child = childern[i];
+        if (child == NULL || !child -> proven) continue;
+        Node* other = best < 0 ? NULL : (Node*)childern[best];
+        if (best < 0 || child -> proven_depth < other -> proven_depth || (child -> proven_depth == other -> proven_depth && nn[i] > nn[best]))
+            best = i;
+    }
+    return best;
+}
+
+}
+
+#endif
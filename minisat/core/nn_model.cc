@@ -0,0 +1,195 @@
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "minisat/core/nn_model.h"
+
+using namespace Minisat;
+
+//=================================================================================================
+// Loading the exported weights:
+
+namespace {
+struct model_file {
+    FILE*   f;
+    int64_t left;                          // the bytes of the file not read yet
+    model_file(const char* path) : f(fopen(path, "rb")), left(0) {
+        if (f != NULL && fseek(f, 0, SEEK_END) == 0) { left = ftell(f); rewind(f); } }
+    ~model_file() { if (f != NULL) fclose(f); }
+    bool word  (int& x)                { uint32_t u; if (fread(&u, sizeof(u), 1, f) != 1) return false; left -= sizeof(u); x = (int)u; return x >= 0; }
+    // (the size is checked against the rest of the file before anything is allocated)
+    bool floats(std::vector<float>& xs, int64_t n) {
+        if (n > left / (int64_t)sizeof(float)) return false;
+        xs.resize(n); left -= n * sizeof(float);
+        return n == 0 || fread(&xs[0], sizeof(float), n, f) == (size_t)n; }
+    bool at_end()                      { return fgetc(f) == EOF; }
+};
+
+// the product of the sizes (which are not negative), or -1 if it is more than limit
+int64_t product(int a, int b, int c, int d, int64_t limit) {
+    int64_t n = 1;
+    const int xs[4] = { a, b, c, d };
+    for (int i = 0; i < 4; i++) {
+        if (xs[i] == 0) return 0;
+        if (n > limit / xs[i]) return -1;
+        n *= xs[i];
+    }
+    return n;
+}
+}
+
+const char* nn_model::load(const char* path) {
+    const char* error = read(path);
+    if (error != NULL) layers.clear();
+    return error;
+}
+
+const char* nn_model::read(const char* path) {
+    static const uint32_t magic = 'M' | 'N' << 8 | 'N' << 16 | '1' << 24;
+    model_file in(path);
+    layers.clear();
+    if (in.f == NULL) return "the model file can not be opened";
+
+    int m, n_value;
+    if (!in.word(m) || (uint32_t)m != magic) return "the model file does not start with MNN1";
+    if (!in.word(rows) || !in.word(cols) || !in.word(chans) || rows < 1 || cols < 1 || chans < 1)
+        return "the input of the model is not valid";
+    if (product(rows, cols, chans, 1, INT_MAX) < 0) return "the input of the model is too large";
+    if (!in.word(n_trunk) || !in.word(n_policy) || !in.word(n_value) || n_policy < 1 || n_value < 1)
+        return "the model needs a policy head and a value head";
+    if ((int64_t)n_trunk + n_policy + n_value > in.left / 8) return "the model file ends in a layer"; // (a layer has two words at least)
+
+    for (int i = 0; i < n_trunk + n_policy + n_value; i++) {
+        layers.emplace_back();
+        layer& l = layers.back();
+        int relu;
+        if (!in.word(l.type)) return "the model file ends in a layer";
+        if (l.type == conv) {
+            if (!in.word(l.kh) || !in.word(l.kw) || !in.word(l.in) || !in.word(l.out) || !in.word(relu)) return "the model file ends in a layer";
+            if (l.kh < 1 || l.kw < 1 || l.out < 1) return "a conv layer of the model is empty";
+        } else if (l.type == dense) {
+            if (!in.word(l.in) || !in.word(l.out) || !in.word(relu)) return "the model file ends in a layer";
+            if (l.out < 1) return "a dense layer of the model is empty";
+            l.kh = l.kw = 1;
+        } else
+            return "a layer of the model is neither conv nor dense";
+        l.relu = relu != 0;
+        int64_t n_weights = product(l.kh, l.kw, l.in, l.out, INT_MAX);
+        if (n_weights < 0) return "a layer of the model is too large";
+        if (!in.floats(l.weights, n_weights) || !in.floats(l.bias, l.out)) return "the model file ends in the weights of a layer";
+    }
+    if (!in.at_end()) return "the model file has more data after the last layer";
+
+    // the shapes: each head starts from the output of the trunk (the sizes of the activations are checked before they are multiplied
+    // out in int, by out_size() and the kernels)
+    scratch = rows * cols * chans;
+    int h = rows, w = cols, c = chans;                  // the shape of the input of the next layer
+    int th = rows, tw = cols, tc = chans;               // ... and of the output of the trunk
+    for (int i = 0; i < (int)layers.size(); i++) {
+        if (i == 0 || i == n_trunk || i == n_trunk + n_policy) { h = th; w = tw; c = tc; }
+        layer& l = layers[i];
+        if (l.type == conv) {
+            if (l.in != c) return "the input channels of a conv layer do not match the layer before";
+            l.in_rows = h; l.in_cols = w; c = l.out;
+        } else {
+            if (l.in != (int64_t)h * w * c) return "the input size of a dense layer does not match the layer before";
+            h = w = 1; c = l.out;
+        }
+        int64_t size = product(h, w, c, 1, INT_MAX);
+        if (size < 0) return "an activation of the model is too large";
+        if (size > scratch) scratch = size;
+        if (i == n_trunk - 1) { th = h; tw = w; tc = c; }
+    }
+    if (layers.back().out_size() != 1) return "the value head of the model does not have one output";
+    return NULL;
+}
+
+bool nn_model::fits(const state_dims& dims) const {
+    return loaded() && rows == dims.dim0 && cols == dims.dim1 && chans == Hyper_Const::dim2 && nact() == dims.nact();
+}
+
+//=================================================================================================
+// The kernels:
+
+// y (in_rows x in_cols x out) = conv(x (in_rows x in_cols x in)), with zero padding so that the output has the shape of the input
+void nn_model::run_conv(const layer& l, const float* x, float* y) {
+    int H = l.in_rows, W = l.in_cols, ci = l.in, co = l.out;
+    int ph = (l.kh - 1) / 2, pw = (l.kw - 1) / 2;
+    for (int r = 0; r < H; r++)
+        for (int c = 0; c < W; c++) {
+            float* out = y + (r * W + c) * co;
+            for (int o = 0; o < co; o++) out[o] = l.bias[o];
+            for (int ky = 0; ky < l.kh; ky++) {
+                int ry = r + ky - ph;
+                if (ry < 0 || ry >= H) continue;
+                for (int kx = 0; kx < l.kw; kx++) {
+                    int cx = c + kx - pw;
+                    if (cx < 0 || cx >= W) continue;
+                    const float* in = x + (ry * W + cx) * ci;
+                    const float* wk = &l.weights[(ky * l.kw + kx) * ci * co];
+                    for (int i = 0; i < ci; i++) {
+                        float a = in[i];
+                        if (a == 0) continue;
+                        const float* wi = wk + i * co;
+                        for (int o = 0; o < co; o++) out[o] += a * wi[o];
+                    }
+                }
+            }
+            if (l.relu)
+                for (int o = 0; o < co; o++) out[o] = out[o] > 0 ? out[o] : 0;
+        }
+}
+
+// y (out) = x (in) * weights (in x out) + bias
+void nn_model::run_dense(const layer& l, const float* x, float* y) {
+    int n = l.in, m = l.out;
+    for (int o = 0; o < m; o++) y[o] = l.bias[o];
+    for (int i = 0; i < n; i++) {
+        float a = x[i];
+        if (a == 0) continue;
+        const float* wi = &l.weights[i * m];
+        for (int o = 0; o < m; o++) y[o] += a * wi[o];
+    }
+    if (l.relu)
+        for (int o = 0; o < m; o++) y[o] = y[o] > 0 ? y[o] : 0;
+}
+
+const float* nn_model::forward(int from, int to, const float* x, float* a, float* b) const {
+    for (int i = from; i < to; i++) {
+        const layer& l = layers[i];
+        if (l.type == conv) run_conv (l, x, a);
+        else                run_dense(l, x, a);
+        x = a;
+        float* t = a; a = b; b = t;
+    }
+    return x;
+}
+
+//=================================================================================================
+// The evaluation:
+
+void nn_model::evaluate(const float* states, int n, float* pi, float* v) const {
+    assert(loaded());
+    std::vector<float> trunk(scratch), a(scratch), b(scratch);
+    int na = nact();
+    for (int s = 0; s < n; s++) {
+        const float* x = states + s * input_size();
+        const float* t = forward(0, n_trunk, x, &a[0], &b[0]);
+        if (n_trunk > 0) { memcpy(&trunk[0], t, layers[n_trunk - 1].out_size() * sizeof(float)); t = &trunk[0]; }
+
+        // the policy: the softmax of the logits
+        const float* logits = forward(n_trunk, n_trunk + n_policy, t, &a[0], &b[0]);
+        float* p   = pi + s * na;
+        float  max = logits[0];
+        for (int i = 1; i < na; i++) max = logits[i] > max ? logits[i] : max;
+        double sum = 0;
+        for (int i = 0; i < na; i++) { p[i] = expf(logits[i] - max); sum += p[i]; }
+        for (int i = 0; i < na; i++) p[i] = (float)(p[i] / sum);
+
+        // the value: the tanh of the output
+        v[s] = tanhf(*forward(n_trunk + n_policy, layers.size(), t, &a[0], &b[0]));
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef Minisat_nn_model_h
+#define Minisat_nn_model_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "minisat/core/state.h"
+
+namespace Minisat {
+
+// nn_model -- the policy and value network, evaluated on the CPU inside the library (see Solver::simulate_native)
+//
+// The network is a trunk of layers on the state, and two heads on the output of the trunk: the policy head gives the logits of the
+// nact actions (pi is their softmax), and the value head gives one number (v is its tanh). A layer is either
+//   conv  -- a 2d convolution over (clauses, variables) with 'same' zero padding and stride 1, or
+//   dense -- a fully connected layer on the flattened input,
+// each with an optional ReLU. The activations are (rows, columns, channels) with the channels innermost, so the state itself is the
+// input of rows dim0, columns dim1 and channels dim2. The inner loop of both kernels runs over the output channels, which are
+// contiguous in the weights and in the output, so that the compiler vectorizes it; inputs that are 0 (most of a state) are skipped.
+//
+// The weights are exported by the trainer into a flat binary file (see export_model in MiniSATEnv.py), of 32 bit little endian words:
+//   'MNN1' (the magic), rows, columns, channels (of the input), the number of layers of the trunk, of the policy head and of the
+//   value head, and then each layer, in that order:
+//     conv : 1, kh, kw, cin, cout, relu, the weights [kh][kw][cin][cout] (floats), the bias [cout]
+//     dense: 2, in, out, relu, the weights [in][out], the bias [out]
+// The model is read only after load(), so one model may be shared by the Solvers of several threads.
+class nn_model {
+public:
+    nn_model() : rows(0), cols(0), chans(0), n_trunk(0), n_policy(0), scratch(0) {}
+
+    const char* load(const char* path);    // read the model of the file (NULL on success, else what is wrong with the file)
+    bool  loaded    () const { return layers.size() > 0; }
+    bool  fits      (const state_dims& dims) const;     // whether the input is a state of dims, and the policy has its nact outputs
+    int   input_size() const { return rows * cols * chans; }
+    int   nact      () const { return layers.empty() ? 0 : layers[n_trunk + n_policy - 1].out_size(); }
+
+    // evaluate n states (input_size() floats each, in a row): nact() floats of pi and one v for each
+    void  evaluate(const float* states, int n, float* pi, float* v) const;
+
+private:
+    enum { conv = 1, dense = 2 };
+    struct layer {
+        int        type;
+        int        kh, kw;                 // (conv) the size of the kernel
+        int        in_rows, in_cols;       // (conv) the rows and columns of the input (the output has the same)
+        int        in, out;                // the input channels and the output channels (dense: the input and the output size)
+        bool       relu;
+        std::vector<float> weights;
+        std::vector<float> bias;
+        int out_size() const { return type == conv ? in_rows * in_cols * out : out; }
+    };
+
+    int        rows, cols, chans;
+    std::vector<layer> layers;             // the trunk, then the policy head, then the value head
+    int        n_trunk, n_policy;
+    int        scratch;                    // the size of the largest activation
+
+    const char*  read(const char* path);  // (load, but the layers read so far are left on error)
+    const float* forward(int from, int to, const float* x, float* a, float* b) const; // run layers [from, to) on x, in a and b
+    static void  run_conv (const layer& l, const float* x, float* y);
+    static void  run_dense(const layer& l, const float* x, float* y);
+};
+
+}
+
+#endif
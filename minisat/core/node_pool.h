@@ -0,0 +1,138 @@
+#ifndef Minisat_node_pool_h
+#define Minisat_node_pool_h
+
+#include <assert.h>
+#include <mutex>
+
+#include "minisat/mtl/XAlloc.h"
+#include "minisat/mtl/Vec.h"
+
+namespace Minisat {
+
+// node_pool -- the memory of all nodes of one Monte Carlo search tree of a Solver (shadow or replay nodes)
+//
+// Nodes are placement constructed in slots carved from large slabs, and the slots of destructed
+// nodes are kept in a free list, so that the memory of one move's search is reused by the next one.
+// A subtree that is no longer needed (the siblings of the new root at next_root) is only handed over
+// with discard(), which is O(1). Its nodes are destructed lazily, one at a time, whenever a new slot
+// is needed and the free list is empty.
+// Each slot has room for 'tail' more bytes after the node (the per action arrays of an mcts_node, see mcts_node::tail_bytes).
+// alloc() and free() may be called by several threads of one search at once (see Solver::explore_parallel).
+// NOTE: the member functions need the complete 'Node' type, so they are only instantiated where it is known.
+template<class Node>
+class node_pool {
+public:
+    node_pool() : free_list(NULL), live(0), tail(0) {}
+    ~node_pool();
+
+    void  use_tail(size_t bytes);  // the bytes after each node (only changed while no node is in use, before the first tree)
+    void* alloc();                 // raw memory for one node and its tail (the caller does the placement new)
+    void  free(Node* s);           // destruct a node that has no childern, and reuse its slot
+    void  discard(Node* root);     // hand over a whole subtree that is no longer needed
+    void  clear();                 // destruct all discarded subtrees now
+
+    int   size() const { return live; }    // number of slots in use (including discarded nodes not yet destructed)
+    int   capacity() const { return slabs.size() * slab_size; }
+    size_t node_bytes() const { return slot_bytes(); } // the bytes of one slot (a node and its tail)
+
+private:
+    enum { slab_size = 64 };       // number of nodes in one slab
+    struct slot { slot* next; };
+    size_t slot_bytes() const {
+        return ((sizeof(Node) + tail > sizeof(slot) ? sizeof(Node) + tail : sizeof(slot)) + alignof(Node) - 1) / alignof(Node) * alignof(Node); }
+
+    vec<void*> slabs;
+    slot*      free_list;
+    vec<Node*> discarded;          // roots of subtrees waiting to be destructed
+    int        live;
+    size_t     tail;
+    std::mutex lock;               // guards all of the above
+
+    void reclaim_one();            // destruct one discarded node (its childern are discarded in turn)
+    void new_slab();
+    void release(Node* s);         // free() with the lock held
+};
+
+template<class Node>
+node_pool<Node>::~node_pool() {
+    clear();
+    assert (live == 0 && "nodes are still in use when the pool is destructed");
+    for (int i = 0; i < slabs.size(); i++)
+        ::free(slabs[i]);
+}
+
+template<class Node>
+void node_pool<Node>::use_tail(size_t bytes) {
+    if (bytes == tail) return;
+    clear();
+    std::lock_guard<std::mutex> guard(lock);
+    assert (live == 0 && "the tail of the nodes is changed while nodes are in use");
+    for (int i = 0; i < slabs.size(); i++)
+        ::free(slabs[i]);
+    slabs.clear();
+    free_list = NULL;
+    tail = bytes;
+}
+
+template<class Node>
+void node_pool<Node>::new_slab() {
+    char* mem = (char*)xrealloc(NULL, slot_bytes() * slab_size);
+    slabs.push(mem);
+    for (int i = slab_size - 1; i >= 0; i--) {
+        slot* s = (slot*)(mem + i * slot_bytes());
+        s -> next = free_list;
+        free_list = s;
+    }
+}
+
+template<class Node>
+void* node_pool<Node>::alloc() {
+    std::lock_guard<std::mutex> guard(lock);
+    // reuse the memory of discarded nodes before asking for a new slab
+    while (free_list == NULL && discarded.size() > 0) reclaim_one();
+    if (free_list == NULL) new_slab();
+    slot* s = free_list;
+    free_list = s -> next;
+    live++;
+    return s;
+}
+
+template<class Node>
+void node_pool<Node>::free(Node* s) {
+    std::lock_guard<std::mutex> guard(lock);
+    release(s);
+}
+
+template<class Node>
+void node_pool<Node>::release(Node* s) {
+    s -> ~Node();
+    slot* sl = (slot*)s;
+    sl -> next = free_list;
+    free_list = sl;
+    live--;
+}
+
+template<class Node>
+void node_pool<Node>::discard(Node* root) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (root != NULL) discarded.push(root);
+}
+
+template<class Node>
+void node_pool<Node>::reclaim_one() {
+    Node* s = discarded.last();
+    discarded.pop();
+    for (int i = 0; i < s -> nact; i++)
+        if (s -> childern[i] != NULL) discarded.push(s -> childern[i]);
+    release(s);
+}
+
+template<class Node>
+void node_pool<Node>::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    while (discarded.size() > 0) reclaim_one();
+}
+
+}
+
+#endif
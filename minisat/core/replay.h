@@ -0,0 +1,25 @@
+#ifndef Minisat_replay_h
+#define Minisat_replay_h
+
+#include "minisat/core/mcts.h"
+
+namespace Minisat {
+
+// replay -- a node of the Monte Carlo search tree for the replay backend
+//
+// Unlike shadow, a replay node stores no solver state at all, only the MCTS statistics. Every simulation
+// applies the actions on the path from the root to the Solver itself (at the speed of Solver::propagate()),
+// writes the state of the new leaf, and then undoes everything with a trail unwind (see Solver::explore).
+// Since the state of a node is recomputed on each visit, it can differ in the learnt clauses from the
+// state seen when the node was created (propagation order depends on the watcher lists).
+class replay : public mcts_node<replay> {
+public:
+    replay(replay* from, int action) : mcts_node<replay>(from, from -> nact, action) { attach_arrays(); } // the child of 'from' at index action
+    replay(int nact)                 : mcts_node<replay>(NULL, nact, -1) { attach_arrays(); }             // the root
+
+    replay* next_root(int action) { return detach_child(action); } // the child at index "action" becomes the root (NULL if it is finished)
+};
+
+}
+
+#endif
@@ -1,4 +1,6 @@
 #include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
 #include "minisat/mtl/Alg.h"
 #include "minisat/mtl/Sort.h"
 #include "minisat/utils/System.h"
@@ -8,6 +10,7 @@
 using namespace Minisat;
 
 shadow::shadow(Solver* from) : 
+    mcts_node<shadow>             (NULL, from -> dims.nact(), -1),
     verbosity                     (from -> verbosity),
     ccmin_mode                    (from -> ccmin_mode),
     phase_saving                  (from -> phase_saving),
@@ -21,33 +24,31 @@ shadow::shadow(Solver* from) :
     learntsize_adjust_cnt         (from -> learntsize_adjust_cnt),
     cla_inc                       (from -> cla_inc),
     clause_decay                  (from -> clause_decay),
-    trail_size                    (from -> trail.size()),
-    trail_lim_size		  (from -> trail_lim.size()),
     qhead                         (from -> qhead),
     ca_size			  (from -> ca.size()),
     learnts_size		  (from -> learnts.size())
     { 
-    	ca_shadow.extra_clause_field = from -> ca.extra_clause_field; 
+    	attach_arrays();
+    	arena = &from -> shadow_arena;
+    	pool = &from -> shadow_nodes;
+    	arena -> extra_clause_field = from -> ca.extra_clause_field; 
     	learnts_copy_is_uninitialized = true;
     	origin = from;
-    	parent = NULL;
-    	index_child_last_pick = -1;
-    	for (int i = 0; i < nact; i++) {
-    		childern[i] = NULL;
-    		pi[i] = 0.0;
-    		qu[i] = 0.0;
-    		uu[i] = 0.0;
-    		nn[i] = 0;
-    		done[i] = false;
-    	    valid[i] = false;
-    	}
-            valid_is_initialized = false;
-            dirichlet_noise_has_been_added = false;
-    	    sumN = 0;
+    	solver = from;
             from -> seen.copyTo(seen); // Maybe optimized to use the same seen object instead of copying it..
+            from -> trail.copyTo(trail);
+            from -> trail_lim.copyTo(trail_lim);
+            from -> assigns.copyTo(assigns);
+            from -> vardata.copyTo(vardata);
+            from -> polarity.copyTo(polarity);
+            counted = from -> ca.size();
+            hash = 0;
+            for (int i = 0; i < trail.size(); i++) hash ^= zobrist(trail[i]);
+            counted_bytes = 0;
     }
 
-shadow::shadow(shadow* from) :
+shadow::shadow(shadow* from, int action) :
+    mcts_node<shadow>             (from, from -> nact, action),
     verbosity                     (from -> verbosity),
     ccmin_mode                    (from -> ccmin_mode),
     phase_saving                  (from -> phase_saving),
@@ -61,144 +62,154 @@ shadow::shadow(shadow* from) :
     learntsize_adjust_cnt         (from -> learntsize_adjust_cnt),
     cla_inc                       (from -> cla_inc),
     clause_decay                  (from -> clause_decay),
-    trail_size                    (from -> trail_size),
-    trail_lim_size		  (from -> trail_lim_size),
     qhead                         (from -> qhead),
     ca_size			  (from -> ca_size),
     learnts_size 		  (from -> get_learnts_size())
 	{
-		ca_shadow.extra_clause_field = from -> ca_shadow.extra_clause_field; 
+		attach_arrays();
+		arena = from -> arena;
+		pool = from -> pool;
 		learnts_copy_is_uninitialized = true;
 		origin = NULL;
-		parent = from;
-		index_child_last_pick = -1;
-		for (int i = 0; i < nact; i++) {
-			childern[i] = NULL;
-			pi[i] = 0.0;
-			qu[i] = 0.0;
-			uu[i] = 0.0;
-			nn[i] = 0;
-			done[i] = false;
-     		        valid[i] = false;
-		}
-		valid_is_initialized = false;
-        dirichlet_noise_has_been_added = false;
-		sumN = 0;
+		solver = from -> solver;
 	    from->seen.copyTo(seen);
+	    from->trail.copyTo(trail);
+	    from->trail_lim.copyTo(trail_lim);
+	    from->assigns.copyTo(assigns);
+	    from->vardata.copyTo(vardata);
+	    from->polarity.copyTo(polarity);
+	    counted = from -> counted;
+	    hash = from -> hash;
+	    counted_bytes = 0;
 	}
 
 shadow::~shadow() {
 	// destruct the data in std::unordered_map<int, vec<Solver::Watcher>* > watches_map;
 	for (std::pair<int, vec<Solver::Watcher>* > element : watches_map) {
-		element.second -> ~vec();
+		delete element.second;
    	 }
+	// the clauses copied into the arena by this shadow are not referenced from anywhere else
+	arena -> release(arena_chunks);
+	solver -> shadow_bytes -= counted_bytes;
+}
+
+// an estimate of the heap memory of this shadow: the dense copies (by their capacity), and the nodes and buckets of the maps
+int64_t shadow::footprint() const {
+    const int64_t node = 2 * sizeof(void*);             // (the overhead of a node of std::unordered_map)
+    int64_t b = pool -> node_bytes();                   // (the shadow and its per action arrays)
+    b += (int64_t)solver -> nVars() * (sizeof(char) + sizeof(lbool) + sizeof(Solver::VarData) + sizeof(char)); // seen, assigns, vardata, polarity
+    b += (int64_t)trail.capacity() * sizeof(Lit) + (int64_t)trail_lim.capacity() * sizeof(int);
+    b += (int64_t)live_clauses.capacity() * sizeof(CRef) + (int64_t)live_learnts.capacity() * sizeof(CRef) + (int64_t)learnts_copy.capacity() * sizeof(CRef);
+    for (std::pair<int, vec<Solver::Watcher>* > element : watches_map)
+        b += sizeof(vec<Solver::Watcher>) + (int64_t)element.second -> capacity() * sizeof(Solver::Watcher);
+    b += (int64_t)watches_map.size()  * (sizeof(std::pair<int, vec<Solver::Watcher>*>) + node) + (int64_t)watches_map.bucket_count()  * sizeof(void*);
+    b += (int64_t)dirty_map.size()    * (sizeof(std::pair<int, char>) + node)                  + (int64_t)dirty_map.bucket_count()    * sizeof(void*);
+    b += (int64_t)cref_map.size()     * (sizeof(std::pair<CRef, CRef>) + node)                 + (int64_t)cref_map.bucket_count()     * sizeof(void*);
+    b += (int64_t)learnts_map.size()  * (sizeof(std::pair<int, CRef>) + node)                  + (int64_t)learnts_map.bucket_count()  * sizeof(void*);
+    b += (int64_t)sat_count_map.size() * (sizeof(std::pair<CRef, int>) + node)                + (int64_t)sat_count_map.bucket_count() * sizeof(void*);
+    return b;
+}
+
+void shadow::account() {
+    int64_t b = footprint();
+    solver -> shadow_bytes += b - counted_bytes;
+    counted_bytes = b;
 }
 
 // This function set the child at index action to be the new root of MCTS
 // the connection between old root and new root is remove, and new root -> origin is set as Solver
 // The pointer to the child at index action is returned (to assign to the root_shadow)
 shadow* shadow::next_root(int action) {
-    if (childern[action] == NULL) // the new root doesn't exist because it is in a finished state
+    shadow* temp = detach_child(action);
+    if (temp == NULL) // the new root doesn't exist because it is in a finished state
         return NULL;
-    childern[action] -> origin = origin;
-    childern[action] -> parent = NULL;
-    shadow* temp = childern[action];
-    childern[action] = NULL;
+    temp -> origin = origin;
     return temp;
 }
 
 // This function push forward the search within the MCTS
-// The key logic is picking the best childern index, which is calculated based on nn, pi, qu and sumN
-// The logic also prevent picking variables whose values are already assigned OR who is not in the state (check "valid" array)
-// it will throw exception if no valid choice can be make (check the "assert" command)
-// if a child index is pick, update the nn and sumN, but the qu (values) has to wait until next simulation call from Solver (need neural net evaluation)
+// The child is picked by pick_child() (see mcts_node), which updates nn and sumN; the qu (values) has to wait until next simulation call from Solver
 // if the child to pick is marked done, it means that the child was visited before, and it stepped into finished state. Return NULL
-// if the child to pick is not NULL, make recursive call from that child
+// if the child to pick is not NULL, make recursive call from that child (unless it is still waiting for its evaluation in a batch: return it)
 // if the child to pick is NULL (given that done is not NULL), construct a new shadow copy for that child and ask the child to step on the index 
 // step() write the new state to array argument, and returns whether the state is done (if done, return false)
-// if the child stepped to "finished state", call its destructor, and set childern[index] as NULL (avoid dangling pointers)
+// if the child stepped to "finished state", call its destructor, and set childern[index] as NULL (avoid dangling pointers), and prove this node
+// (one step: see mcts_node::prove). A new child may prove this node too, as the childern that are not expanded yet are the ones that keep
+// a longer proven line from being the shortest
 // return childern[index] (could be NULL if the child stepped to finished state) (otherwise, the returned pointer is to the leaf_shadow whose pi needs evaluation)
-// NOTE: index_child_last_pick is a field in this object, which tracks the most recent pick of childern IMPORTANT for assigning qu and pi later!!!
-shadow* shadow::next_to_explore(float* array) {
-	// pick a child to simulate by the score system (TODO: space for optimization)
+shadow* shadow::next_to_explore(state_out array) {
 	assert (valid_is_initialized && "time to explore but the valid [] is still not initialized");
-
-    // if this is the root node, and the dirichlet noise has not been added to the pi, add dirichlet noise
-    if (parent == NULL && !dirichlet_noise_has_been_added) {
-        double di[Hyper_Const::nact];
-        Hyper_Const::generate_dirichlet(di);
-        for (int i = 0; i < Hyper_Const::nact; i++) {
-            pi[i] = pi[i] * 0.75f + ((float)di[i]) * 0.25f;
-        }
-        //fflush(stdout); assert(false);
-        dirichlet_noise_has_been_added = true;
-    }
-
-	index_child_last_pick = -1; float pick_val;
-	for (int i = 0; i < nact; i++) { 
-		if (!valid[i]) continue; // IMPORTANT: only check Lit that exists in current state 
-		uu[i] = c_act * pi[i] * sqrt(sumN) / (1 + nn[i]);
-		float val = nn[i] == 0? uu[i] : uu[i] + qu[i] / nn[i];
-		if (index_child_last_pick == -1 || val > pick_val) {		
-			index_child_last_pick = i; pick_val = val;
-		}
-	}
-	assert (index_child_last_pick >= 0 && "failed to pick a good action for simulation");
-
-	// found a child to simulate
-//	printf("(%d)", index_child_last_pick); fflush(stdout);
-	nn[index_child_last_pick] += 1; sumN++;
-	if (done[index_child_last_pick]) { // the picked child is already visited before and the child is in a done state
+	int pick = pick_child();
+	if (done[pick]) { // the picked child is already visited before and the child is in a done state
 		return NULL;
 	}
-	if (childern[index_child_last_pick] != NULL) {
-		return childern[index_child_last_pick] -> next_to_explore(array);
+	shadow* child = childern[pick];
+	if (child != NULL) {
+		if (child -> waiting) return child;
+		return child -> next_to_explore(array);
 	} else {
-		childern[index_child_last_pick] = new shadow(this);
-	        done[index_child_last_pick] = !(childern[index_child_last_pick] -> step(toLit(index_child_last_pick), array));
-		if (done[index_child_last_pick]) {
-			childern[index_child_last_pick] -> ~shadow();
-			childern[index_child_last_pick] = NULL;
+		child = new (pool -> alloc()) shadow(this, pick);
+		done[pick] = !(child -> step(toLit(pick), array));
+		if (done[pick]) {
+			pool -> free(child);
+			prove();
+			return NULL;
 		}
-		return childern[index_child_last_pick];
+		childern[pick] = child;
+		prove();
+		return child;
 	}
 }
 
-// this function writes nn (visit count) to array (some numpy array provided by RL algorithm)
-void shadow::get_visit_count(float* array) {
-	for (int i = 0; i < nact; i++)
-		array[i] = nn[i];
+// The same selection and expansion, but run by one of several threads that explore this tree at once (see Solver::explore_parallel).
+// Unlike the one above, the virtual loss is added on each edge on the way down, so that the other threads turn away from this path,
+// and removed again if this selection does not end in a new leaf.
+// A new child is claimed before its step, with a compare and swap on childern[pick] (it is 'waiting' from then on): a thread that
+// loses the race goes on with the winner's child. A child that steps into a finished state stays in place, because other threads
+// may still hold it: it is added to 'finished', to be taken out and freed when all threads are done.
+// return the new leaf, or NULL if the selection stepped into a finished state, or NULL with 'collided' set to true if it ran into
+// a leaf that is waiting (its visit is undone, as in the serial loop of Solver::explore_leaves)
+shadow* shadow::next_to_explore(state_out array, vec<shadow*>& finished, bool& collided) {
+	collided = false;
+	shadow* node = this;
+	while (true) {
+		assert (node -> valid_is_initialized && "time to explore but the valid [] is still not initialized");
+		int pick = node -> pick_child();
+		node -> vloss[pick]++;
+		shadow* child = node -> childern[pick];
+		if (child == NULL && !node -> done[pick]) {
+			shadow* claim = new (pool -> alloc()) shadow(node, pick);
+			claim -> waiting = true;
+			if (node -> childern[pick].compare_exchange_strong(child, claim)) {
+				if (claim -> step(toLit(pick), array)) { node -> prove(); return claim; }
+				node -> done[pick] = true;
+				node -> prove();
+				finished.push(claim);
+				node -> undo_path(pick, 0, 1);
+				return NULL;
+			}
+			pool -> free(claim); // child is now the one of the thread that won
+		}
+		if (node -> done[pick]) {
+			node -> undo_path(pick, 0, 1);
+			return NULL;
+		}
+		if (child -> waiting) {
+			node -> undo_path(pick, 1, 1);
+			collided = true;
+			return NULL;
+		}
+		node = child;
+	}
 }
 
-// helper function for write_clause (return true if a Clause c is already satisfied)
+// helper function for collect_live (return true if a Clause c is already satisfied)
 bool shadow::satisfied(const Clause& c) const {
     for (int i = 0; i < c.size(); i++)
         if (value(c[i]) == l_True)
             return true;
     return false; 
 }
-// helper function for generate_state (write state to a 1D array and returns the next col to write to)
-int shadow::write_clause(const Clause& c, int index_col, float* array) {
-	if (satisfied(c)) return index_col;
-	for (int i = 0; i < c.size(); i++) {
-    	if (value(c[i]) != l_False) {
-    		int index_row = var(c[i]); int index_z = int(sign(c[i]));
-        	int index = index_z + index_row * dim2 + index_col * dim1 * dim2;
-    		array[index] = 1.0;
-            // at the same time, we mark toInt(c[i]) as valid simulation options
-    	    valid[toInt(c[i])] = true;
-   		}
-	}
-	return index_col + 1;
-}
-
-int shadow::write_valid(const Clause& c, int index_col) {
-    if (satisfied(c)) return index_col;
-    for (int i = 0; i < c.size(); i++) 
-        if (value(c[i]) != l_False) 
-            valid[toInt(c[i])] = true;
-    return index_col + 1;
-}
 
 // this function assumes that this shadow is the root_shadow used in MCT in Solver
 // this function checks that this shadow's state is consistent with that of the Solver
@@ -207,26 +218,35 @@ bool shadow::check_state() {
     assert (origin != NULL && "origin should not be NULL for root_shadow");
     // now assert about the states
     // trail:
-    assert (trail_size == origin -> trail.size() && "INCONSISTANCY: trail size are different");
-    for (auto it : trail_map) 
-        assert(it.second == origin -> trail[it.first] && "INCONSISTANCY: trail i is different");
+    assert (trail.size() == origin -> trail.size() && "INCONSISTANCY: trail size are different");
+    for (int i = 0; i < trail.size(); i++)
+        assert(trail[i] == origin -> trail[i] && "INCONSISTANCY: trail i is different");
+    // hash (of the assignment on the trail):
+    uint64_t h = 0;
+    for (int i = 0; i < trail.size(); i++) h ^= zobrist(trail[i]);
+    assert (hash == h && "INCONSISTANCY: hash is not the one of the trail");
+    (void)h;
     // trail_lim:
-    assert (trail_lim_size == origin -> trail_lim.size() && "INCONSISTANCY: trail lim size are different");
-    for (auto it : trail_lim_map)
-        assert(it.second == origin -> trail_lim[it.first] && "INCONSISTANCY: trail_lim i is different");
+    assert (trail_lim.size() == origin -> trail_lim.size() && "INCONSISTANCY: trail lim size are different");
+    for (int i = 0; i < trail_lim.size(); i++)
+        assert(trail_lim[i] == origin -> trail_lim[i] && "INCONSISTANCY: trail_lim i is different");
     // qhead:
     assert (qhead == origin -> qhead && "INCONSISTANCY: qhead is different");
-    // assigns:
-    for (auto it : assigns_map)
-        assert(it.second == origin -> assigns[it.first] && "INCONSISTANCY: assigns i is different");
-    // vardata:
-    for (auto it : vardata_map) {
-        assert(it.second.reason == (origin -> vardata[it.first]).reason && "INCONSISTANCY: vardata i reason is different");
-        assert(it.second.level == (origin -> vardata[it.first]).level && "INCONSISTANCY: vardata i level is different");
+    // assigns, vardata and polarity (only assigned variables carry a meaningful vardata):
+    for (Var v = 0; v < origin -> nVars(); v++) {
+        assert(assigns[v] == origin -> assigns[v] && "INCONSISTANCY: assigns i is different");
+        assert(polarity[v] == origin -> polarity[v] && "INCONSISTANCY: polarity i is different");
+        if (assigns[v] == l_Undef) continue;
+        assert(vardata[v].reason == origin -> vardata[v].reason && "INCONSISTANCY: vardata i reason is different");
+        assert(vardata[v].level == origin -> vardata[v].level && "INCONSISTANCY: vardata i level is different");
     }
-    // polarity map:
-    for (auto it : polarity_map)
-        assert(it.second == origin -> polarity[it.first] && "INCONSISTANCY: polarity i is different");
+    // satisfaction counters (of the Solver's clauses that this shadow counts):
+    for (int i = 0; i < origin -> clauses.size(); i++)
+        if (origin -> clauses[i] < counted)
+            assert(get_sat_count(origin -> clauses[i]) == origin -> ca[origin -> clauses[i]].satCount() && "INCONSISTANCY: sat_count of clause i is different");
+    for (int i = 0; i < origin -> learnts.size(); i++)
+        if (origin -> learnts[i] < counted)
+            assert(get_sat_count(origin -> learnts[i]) == origin -> ca[origin -> learnts[i]].satCount() && "INCONSISTANCY: sat_count of learnt i is different");
     // learnts:
     if (learnts_copy_is_uninitialized) {
         assert (learnts_size == origin -> learnts.size() && "INCONSISTANCY: learnts size are different 1");
@@ -239,31 +259,26 @@ bool shadow::check_state() {
     }
     // ca_size
     assert (ca_size == origin -> ca.size() && "INCONSISTANCY: ca size are different");
-    // ca_shadow
+    // copied clauses in the arena
     for (auto it : cref_map) {
         Clause& c1 = origin -> ca[it.first];
-        Clause& c2 = ca_shadow[it.second];
+        Clause& c2 = (*arena)[it.second];
         assert (c1.size() == c2.size() && "INCONSISTANCY: clauses have different sizes");
         assert (c1.learnt() == c2.learnt() && "INCONSISTANCY: clauses are not labeled as learnt in the same way");
         assert (c1.has_extra() == c2.has_extra() && "INCONSISTANCY: clauses has_extra are different");
         assert (c1.mark() == c2.mark() && "INCONSISTANCY: clauses mark are different");
         for (int i = 0 ; i < c1.size(); i++) {
-		if (c1[i] != c2[i]) {
-			printf("||%d %d %d %d %d||", it.first, it.second, c1.size(), c1.learnt(), c1.mark());
-			for (int j = 0; j < c1.size(); j++) 
-				printf("(%d,%d)", toInt(c1[j]), toInt(c2[j]));
-			fflush(stdout);
-		}
+		if (c1[i] != c2[i])
+			report("clause %d (copy %d, size %d, learnt %d, mark %d) differs at %d: %d in the Solver, %d in the copy",
+			       it.first, it.second, c1.size(), c1.learnt(), c1.mark(), i, toInt(c1[i]), toInt(c2[i]));
 		assert (c1[i] == c2[i] && "INCONSISTANCY: clauses content i are different");
 	}
     }
     // watches_map (check for those that we copied watches vector, the dirty values of the keys are the same)
     for (auto it : watches_map) {
 	Lit 		      key     = toLit(it.first);
-	if (get_dirty(key) != origin -> watches.is_dirty(key)) {
-		printf("DD %d&%d", get_dirty(key), origin -> watches.is_dirty(key));
-	}
-	fflush(stdout);
+	if (get_dirty(key) != origin -> watches.is_dirty(key))
+		report("the watches of %d are dirty %d, and %d in the Solver", toInt(key), get_dirty(key), origin -> watches.is_dirty(key));
 	assert (get_dirty(key) == origin -> watches.is_dirty(key) && "INCONSISTANCY: dirtyness are different");   	
     }
     // maybe more assert for watches_map??
@@ -272,6 +287,18 @@ bool shadow::check_state() {
     return true; 
 }  
 
+// (several threads may check their shadows at once, hence one locked write)
+void shadow::report(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    flockfile(stderr);
+    fprintf(stderr, "shadow: ");
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    funlockfile(stderr);
+    va_end(args);
+}
+
 void shadow::check_self() const {
 	// watches map (check for watches map is only to make sure that the key is either the first or the second lit in clauses)
     for (auto it : watches_map) {
@@ -281,9 +308,8 @@ void shadow::check_self() const {
             Solver::Watcher watcher = watches[i];
             CRef cr = watcher.cref;
             const Clause& c = get_clause(cr);
-    	    if (c[0] != ~key && c[1] != ~key) {
-    	    	printf("{{%d}[%d,%d]}", ~key, c[0], c[1]); fflush(stdout);
-    	    }	  
+    	    if (c[0] != ~key && c[1] != ~key)
+    	    	report("clause %d in the watches of %d watches %d and %d", cr, toInt(key), toInt(c[0]), toInt(c[1]));
             assert (c[0] == ~key || c[1] == ~key);
         }
     }
@@ -293,82 +319,97 @@ void shadow::check_self() const {
 		Lit 		      key     = toLit(it.first);
 		if (!get_dirty(key)) {
     		for (int i = 0; i < watches.size(); i++) {
-                if (get_clause(watches[i].cref).mark()) {
-                	CRef target = watches[i].cref;
-                	if (cref_map.count(target) == 0) printf("shadow does not have a copy of this clause\n");
-                	else printf("shadow has a copy of this clause\n");
-                }
+                if (get_clause(watches[i].cref).mark())
+                	report("clause %d in the clean watches of %d is deleted (%s)", watches[i].cref, toInt(key),
+                	       cref_map.count(watches[i].cref) == 0 ? "no copy in this shadow" : "a copy in this shadow");
 			    assert (!(get_clause(watches[i].cref).mark()) && "clean key has marked clauses!");
 			}
 		}
 	} 
 }
 
-// write state in tensor "array" as side effect (if too many clauses to write, cut off by dim0)
-// return true if state is not empty (not solved), false otherwise
-bool shadow::generate_state(float* array) {
-	int index_col = 0;
-	// write clauses in array (optimization:: get hold of the Solver's clause and work from there)
-	shadow* temp = this;
-	while (temp -> parent != NULL) {
-		temp = temp -> parent;
-   	}
-	Solver* solver = temp -> origin;
+// collect the clauses that are not satisfied in this shadow (the live clauses), in the order they are written to the state
+// NOTE: original clauses are read from the Solver's ca directly. Propagation in a shadow may reorder the literals of a copied clause,
+//       but never changes its set of literals, which is all that the state needs.
+void shadow::collect_live() {
 	vec<CRef>& clauses = solver -> clauses;
-	ClauseAllocator& ca = solver -> ca;
-	for (int i = 0; i < clauses.size() && index_col < dim0; i++) 
-	        index_col = write_clause(ca[clauses[i]], index_col, array);
-   	// write learnts in array
-	for (int i = 0; i < get_learnts_size() && index_col < dim0; i++)
-    		index_col = write_clause(get_clause(get_learnts(i)), index_col, array);
-    /* printf("clause %d, learnts %d\n", clauses.size(), get_learnts_size());
-    for (int i = 0; i < trail_size; i++) {
-        printf("%d_", get_trail(i).x);
-    }
-    printf("\n");
-    for (int i = 0; i < 20; i++) {
-        printf("%d_", get_assigns(i));
-    }
-    printf("\n"); */
-    valid_is_initialized = true;
+	live_clauses.clear();
+	live_learnts.clear();
+	for (int i = 0; i < clauses.size(); i++)
+		if (!satisfied(clauses[i])) live_clauses.push(clauses[i]);
+	for (int i = 0; i < get_learnts_size(); i++)
+		if (!satisfied(get_learnts(i))) live_learnts.push(get_learnts(i));
+}
+
+// collect the live clauses from the live clauses of "from" (the parent)
+// this is only valid if the trail of this shadow extends the trail of "from" (a step without conflict): then no clause
+// became live again, no clause was learnt, and only the clauses that were live in "from" need to be checked
+void shadow::collect_live(const shadow& from) {
+	live_clauses.clear();
+	live_learnts.clear();
+	for (int i = 0; i < from.live_clauses.size(); i++)
+		if (!newly_satisfied(from.live_clauses[i])) live_clauses.push(from.live_clauses[i]);
+	for (int i = 0; i < from.live_learnts.size(); i++)
+		if (!newly_satisfied(from.live_learnts[i])) live_learnts.push(from.live_learnts[i]);
+}
+
+// write the live clauses in tensor "array" (if too many clauses to write, cut off by dim0), and mark the valid actions.
+// array can be nowhere (state_out()), to only generate the valid array
+// return true if state is not empty (not solved), false otherwise
+bool shadow::write_state(state_out array) {
+	switch (state_words(solver -> dims)) {
+	case 1:  return write_state<1>(array);
+	case 2:  return write_state<2>(array);
+	default: return write_state<4>(array);
+	}
+}
+
+template<int W>
+bool shadow::write_state(state_out array) {
+	ClauseAllocator& ca = get_origin() -> ca;
+	state_writer<W> w(array, solver -> dims);
+	for (int i = 0; i < live_clauses.size() && !w.full(); i++)
+		w.write(*this, ca[live_clauses[i]]);
+	for (int i = 0; i < live_learnts.size() && !w.full(); i++)
+		w.write(*this, get_clause(live_learnts[i]));
+	w.finish();
+	state_key = w.key();
+	solver -> dims.mark_valid(w.valid_mask(), valid);
+	valid_is_initialized = true;
 
 	// add more assert to check for the correctness of the state of simulation
 	check_self();
-    return index_col > 0;
+	return w.size() > 0;
 }
 
-// over-loaded functions to just generate valid array
+// write state in tensor "array" as side effect (if too many clauses to write, cut off by dim0)
+// return true if state is not empty (not solved), false otherwise
+bool shadow::generate_state(state_out array) {
+	collect_live();
+	return write_state(array);
+}
+
+// collect the live clauses and generate the valid array of a new root, without writing its state again:
+// the state of the root is the one of the Solver, which search() has just written (and kept its valid actions)
 bool shadow::generate_valid() {
-    int index_col = 0;
-    // write clauses in array (optimization:: get hold of the Solver's clause and work from there)
-    shadow* temp = this;
-    while (temp -> parent != NULL) {
-        temp = temp -> parent;
-    }
-    Solver* solver = temp -> origin;
-    vec<CRef>& clauses = solver -> clauses;
-    ClauseAllocator& ca = solver -> ca;
-    for (int i = 0; i < clauses.size() && index_col < dim0; i++) 
-        index_col = write_valid(ca[clauses[i]], index_col);
-    // write learnts in array
-    for (int i = 0; i < get_learnts_size() && index_col < dim0; i++)
-        index_col = write_valid(get_clause(get_learnts(i)), index_col);
-    valid_is_initialized = true;
-    return index_col > 0;
+	assert(origin != NULL);
+	collect_live();
+	origin -> dims.mark_valid(origin -> state_valid, valid);
+	state_key = origin -> state_key;
+	valid_is_initialized = true;
+	check_self();
+	account();
+	return live_clauses.size() + live_learnts.size() > 0;
 }
 
 // this function return true if state is not solved, false otherwise (note no parameters)
 bool shadow::generate_state() {
-	shadow* temp = this;
-	while (temp -> parent != NULL) temp = temp -> parent;
-	Solver* solver = temp -> origin;
 	vec<CRef>& clauses = solver -> clauses;
-	ClauseAllocator& ca = solver -> ca;
 	for (int i = 0; i < clauses.size(); i++) {
-		if (!satisfied(ca[clauses[i]])) return true;
+		if (!satisfied(clauses[i])) return true;
 	}
 	for (int i = 0; i < get_learnts_size(); i++) {
-		if (!satisfied(get_clause(get_learnts(i)))) return true;
+		if (!satisfied(get_learnts(i))) return true;
 	}
 	return false;
 }
@@ -380,16 +421,20 @@ void shadow::uncheckedEnqueue(Lit p, CRef from)
     set_assigns(var(p), lbool(!sign(p)));
     set_vardata(var(p), Solver::mkVarData(from, decisionLevel()));
     append_trail(p);
+    update_sat_count(p, 1);
+    hash ^= zobrist(p);
 }
 
 // propagate the newly assigned Lits
 CRef shadow::propagate()
 {
     CRef    confl     = CRef_Undef;
+    int     num_props = 0;
 
-    while (qhead < trail_size){
+    while (qhead < trail.size()){
         Lit                   p  = get_trail(qhead++); // 'p' is enqueued fact to propagate.
         vec<Solver::Watcher>& ws = get_watches_copied(p);
+        num_props++;
 
         if (get_dirty(p)) clean_watches(p); // Comments by Fei: the initial lookup function garantees that the watcher list is cleaned!!
         Solver::Watcher *i, *j, *end;
@@ -411,12 +456,8 @@ CRef shadow::propagate()
             	cc[0] = cc[1]; cc[1] = false_lit;
             } 
   	    const Clause& c = get_clause(cr); // re-initialize the value c, because there may already be a copy and change
-	    if (c[1] != false_lit) {
-		printf("%s/%s ", c.learnt()? "L":"O", c.mark()? "M":"Z");
-		for (int i = 0; i < c.size(); i++)
-			printf("%d ", toInt(c[i]));
-		printf("^%d\n", toInt(false_lit)); fflush(stdout);
-	    }
+	    if (c[1] != false_lit)
+		report("clause %d (learnt %d, mark %d) watched by %d has %d and %d first", cr, c.learnt(), c.mark(), toInt(false_lit), toInt(c[0]), toInt(c[1]));
             assert(c[1] == false_lit);
             i++; 
 
@@ -440,7 +481,7 @@ CRef shadow::propagate()
             *j++ = w;
             if (value(first) == l_False){
                 confl = cr; 
-                qhead = trail_size;
+                qhead = trail.size();
                 // Copy the remaining watches:
                 while (i < end)
                     *j++ = *i++;
@@ -452,6 +493,7 @@ CRef shadow::propagate()
         }
         ws.shrink(i - j);
     }
+    solver -> mcts_propagations += num_props; // (for the propagation budget of the Solver)
     return confl;
 }
 
@@ -493,7 +535,7 @@ void shadow::analyze(CRef confl, vec<Lit>& out_learnt, int& out_btlevel) {
 
     // Generate conflict clause:
     out_learnt.push();      // (leave room for the asserting literal)
-    int index = trail_size - 1;
+    int index = trail.size() - 1;
     do {
         assert(confl != CRef_Undef); // (otherwise should be UIP)
         const Clause& c = get_clause(confl); 
@@ -631,16 +673,18 @@ bool shadow::litRedundant(Lit p) {
 // Revert to the state at given level (keeping all assignment at 'level' but not beyond).
 void shadow::cancelUntil(int level) {
     if (decisionLevel() > level) {
-        for (int c = trail_size - 1; c >= get_trail_lim(level); c--) {
+        for (int c = trail.size() - 1; c >= get_trail_lim(level); c--) {
             Var x  = var(get_trail(c));
             set_assigns(x, l_Undef);
-            if (phase_saving > 1 || (phase_saving == 1 && c > get_trail_lim(trail_lim_size - 1)))
+            update_sat_count(get_trail(c), -1);
+            hash ^= zobrist(get_trail(c));
+            if (phase_saving > 1 || (phase_saving == 1 && c > get_trail_lim(trail_lim.size() - 1)))
                 set_polarity(x, sign(get_trail(c)));
             // insertVarOrder(x);  remove code related with ordering
         }
         qhead = get_trail_lim(level);
-        trail_map_clear_until(qhead);
-        trail_lim_map_clear_until(level);
+        trail_clear_until(qhead);
+        trail_lim_clear_until(level);
     } 
 }
 
@@ -677,7 +721,7 @@ void shadow::removeClause(CRef cr) {
     // Don't leave pointers to free'd memory!
     if (locked(c)) set_vardata(var(c[0]), Solver::mkVarData(CRef_Undef, get_vardata(var(c[0])).level));
     c.mark(1);
-    ca_shadow.free(cref_map.at(cr)); 
+    arena -> free(arena_chunks, cref_map.at(cr)); 
 }
 
 
@@ -685,8 +729,9 @@ void shadow::removeClause(CRef cr) {
 // it returns true if the state is not yet finished and array has non-zero values in it.
 // NOTE: restart and garbage collection are disabled in this function, and similar functionality has to be disabled in Solver::search as well to 
 //       keep the simulation step consistent with the actual step
-bool shadow::step(Lit action, float* array)
+bool shadow::step(Lit action, state_out array)
 { 
+	bool conflicted = false; // without a conflict, the state is built from the live clauses of the parent
 	newDecisionLevel();
     uncheckedEnqueue(action);
 
@@ -697,6 +742,7 @@ bool shadow::step(Lit action, float* array)
 //            printf("C"); fflush(stdout);
             // conflicts++; conflictCounts++; // Comments by Fei: replace usage! conflictC++; 
             if (decisionLevel() == 0) return false; // terminate with UNSAT, return false because nothing written in the array argument for evaluation 
+            conflicted = true;
 
             vec<Lit> learnt_clause; // Comments by Fei: make this variable local to loop (used and destroyed)
             learnt_clause.clear();
@@ -735,7 +781,11 @@ bool shadow::step(Lit action, float* array)
             // remove code about assumptions. 
             // save states and return true if state is not finished, false otherwise
 //            printf("G"); fflush(stdout);
-            return generate_state(array); 
+            if (parent != NULL && !conflicted) collect_live(*parent);
+            else                               collect_live();
+            bool live = write_state(array);
+            account(); // (the shadow does not change after its step, except for the MCTS statistics)
+            return live; 
         }
     }
 }
@@ -798,3 +848,4 @@ void shadow::garbageCollect()
     to.moveTo(ca);
     */
 }
+
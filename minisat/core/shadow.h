@@ -8,49 +8,58 @@
 #include "minisat/utils/Options.h"
 #include "minisat/core/SolverTypes.h"
 #include "minisat/core/Const.h"
+#include "minisat/core/node_pool.h"
+#include "minisat/core/mcts.h"
+#include "minisat/core/state.h"
 #include <unordered_map>
 
 namespace Minisat {
 
+// the Zobrist key of a literal: a fixed pseudo random 64 bit number (a mix of toInt(p), so that no table is kept)
+// the hash of an assignment is the xor of the keys of its true literals, so it is updated by one xor per (un)assigned literal
+inline uint64_t zobrist(Lit p) { return mix64(((uint64_t)toInt(p) + 1) * 0x9E3779B97F4A7C15ULL); }
+
 class Solver; 
-class shadow {
+class shadow : public mcts_node<shadow> {
 public:
-    shadow(shadow* from); 
+    shadow(shadow* from, int action); // the child of 'from' at index action
     shadow(Solver* from); 
     virtual ~shadow();
 
-    const int nact = Hyper_Const::nact;
-    const int dim0 = Hyper_Const::dim0;
-    const int dim1 = Hyper_Const::dim1;
-    const int dim2 = Hyper_Const::dim2;
-    const float c_act = Hyper_Const::c_act;
-    const int MCTS_size_lim = Hyper_Const::MCTS_size_lim;
-
     Solver* origin;                      // this points to the Solver instance that these shadows are cloned from (will be null if not root node)
-    shadow* parent;                      // this points to the parent shadow node (will be null if this is the root node)
-    int index_child_last_pick;           // this field remembers the child of choice during MCTS, for assigning Q after passing the state in neural net.
-    shadow* childern[Hyper_Const::nact]; // this is an array of pointers to all the childern of this node (could be null if childern not visited yet)
-    float pi[Hyper_Const::nact];         // this is an array of pi values (initial visiting probality for MCTS simulation)
-    float qu[Hyper_Const::nact];         // this is an array of qu values (total expect score for MCTS simulation)
-    int   nn[Hyper_Const::nact];         // this is an array of nn values (total visit count for each childern in MCTS simulation)
-    float uu[Hyper_Const::nact];         // this is an array of U values (combine pi and nn values)
-    bool done[Hyper_Const::nact];        // this is an array to label if a child branch leads to finished state
-    int sumN;                            // this is the total number of MCTS simulations run from this node (sum of nn)
-    bool valid[Hyper_Const::nact];       // this array marks all valid steps (for simulation) (constructed by generate_state() function)
-    bool valid_is_initialized;
-    bool dirichlet_noise_has_been_added; // 
+    Solver* solver;                      // the same Solver, but set in every shadow of the tree (see get_origin())
+    // NOTE: parent, childern and the MCTS statistics are in mcts_node
     
     // MCTS functions
     shadow* next_root(int action); // this function set child at index "action" to be the next root, it returns the pointer to the new root
-    void    get_visit_count(float* count); // this function writes the nn array to array argument
-    shadow* next_to_explore(float* state); // this function initiate simulation from this shadow, will write state to state argument, returns leaf shadow 
+    shadow* next_to_explore(state_out state); // this function initiate simulation from this shadow, will write state to state argument, returns leaf shadow 
+    shadow* next_to_explore(state_out state, vec<shadow*>& finished, bool& collided); // the same, safe for several threads in one tree
 
-    bool generate_state(float*); // this function askes this node to write its state to the argument given by RL algorithm (no memory copy, inplace write)
+    bool generate_state(state_out); // this function askes this node to write its state to the argument given by RL algorithm (no memory copy, inplace write)
     bool generate_state();       // this function returns true if state is not solved
-    int  write_clause (const Clause& c, int index_col, float* array); // helper function of "generate_state" for a clause
-    bool satisfied    (const Clause& c) const;                        // helper function of "write_clause"
-    bool generate_valid();
-    int  write_valid(const Clause& c, int index_col);
+    bool satisfied    (const Clause& c) const;                        // helper function of "collect_live" (scans the literals)
+    bool satisfied    (CRef cr) const;                                // helper function of "collect_live" (by the satisfaction counter if there is one)
+    bool newly_satisfied(CRef cr) const;                              // the same, for a clause that is live in the parent (by the counters of this shadow only)
+    bool generate_valid();       // collect the live clauses and the valid actions of a new root (its state is already written by the Solver)
+
+    // the live (not satisfied) clauses of this shadow, in the order they are written to the state
+    vec<CRef> live_clauses;                      // original clauses
+    vec<CRef> live_learnts;                      // learnt clauses
+    void collect_live();                         // collect the live clauses by a scan of all clauses
+    void collect_live(const shadow& from);       // collect the live clauses incrementally from those of the parent (only after a step without conflict)
+    bool write_state(state_out array);           // write the live clauses to array (can be nowhere) and mark the valid actions (see state.h)
+    template<int W>
+    bool write_state(state_out array);           // ... for the state_writer<W> of the Solver's dims
+    Solver* get_origin() const;                  // the Solver at the root of the tree
+
+    // the number of true literals of the Solver's clauses in the state of this shadow (by CRef), kept like the watches: only the counters
+    // changed by the step of this shadow are in its map, the others are those of its parent (up to the Solver's clauses at the root)
+    // NOTE: only the clauses below 'counted' (the Solver's clauses when the root was made) have a counter. Clauses allocated after
+    //       (learnt in this tree, or in a real step after the tree was built) are checked by their literals.
+    std::unordered_map<CRef, int> sat_count_map;
+    CRef counted;
+    int  get_sat_count(CRef cr) const;
+    void update_sat_count(Lit p, int delta);     // add delta to the counters of the Solver's clauses containing p (p became true or unassigned)
 
 
     // Mode of operation: Directly copied from Solver class. Used during simulation 
@@ -82,36 +91,40 @@ public:
     vec<Lit>             add_tmp;
 
     
-    // fields and methods for caching the difference 
-    // NOTE: data structures here are never directly accessed. Instead, use the getter and setter functions. 
-    // The getter and setter functions take care of the logic of only storing the difference
-    // Implementation of these functions are inlined in this file
-    std::unordered_map<int, Lit> trail_map;
-    int trail_size; 
+    // fields and methods for the assignment state
+    // NOTE: unlike the difference maps below, these are dense copies taken from the parent (or the Solver) at construction,
+    // so that value(), get_vardata() and get_trail() are a single array access no matter how deep this shadow is in the tree.
+    vec<Lit> trail; 
     Lit get_trail(int x) const; 
     void append_trail(Lit y); 
-    void trail_map_clear_until(int x);                    // corresponding to trail.shrink to x
+    void trail_clear_until(int x);                        // corresponding to trail.shrink to x
 
-    std::unordered_map<int, int> trail_lim_map;
-    int trail_lim_size; 
+    vec<int> trail_lim; 
     int get_trail_lim(int x) const; 
     void append_trail_lim(int y); 
-    void trail_lim_map_clear_until(int level);            // corresponding to trail_lim.shrink to level
+    void trail_lim_clear_until(int level);                // corresponding to trail_lim.shrink to level
 
     int qhead;
 
-    std::unordered_map<Var, lbool> assigns_map; 
+    VMap<lbool> assigns;                                  // The current assignments.
     lbool get_assigns(Var x) const;        
     void set_assigns(Var x, lbool y); 
 
-    std::unordered_map<Var, Solver::VarData> vardata_map; // Stores reason and level for each variable.
+    VMap<Solver::VarData> vardata;                        // Stores reason and level for each variable.
     Solver::VarData get_vardata(Var x) const;
     void set_vardata(Var x, Solver::VarData data); 
 
-    std::unordered_map<Var, char> polarity_map;           // The preferred polarity of each variable.
+    VMap<char> polarity;                                  // The preferred polarity of each variable.
     char get_polarity(Var x) const;
     void set_polarity(Var x, char y);
 
+    uint64_t hash;                                        // the Zobrist hash of assigns (see zobrist()), kept by uncheckedEnqueue and cancelUntil
+    bool transposable() const;                            // true if the state of this shadow is a function of its assignment alone (see Solver::find_transposition)
+
+    // fields and methods for caching the difference 
+    // NOTE: data structures here are never directly accessed. Instead, use the getter and setter functions. 
+    // The getter and setter functions take care of the logic of only storing the difference
+    // Implementation of these functions are inlined in this file
     std::unordered_map<int, vec<Solver::Watcher>* > watches_map; 
     std::unordered_map<int, char> dirty_map;
     vec<Solver::Watcher>& get_watches_copied(Lit p);
@@ -120,7 +133,9 @@ public:
     void clean_watches(Lit p);                            // remove deleted clause (mark is true) from watcher list 
     bool assert_clean(vec<Solver::Watcher>& ws);          // this function returns true if all watches are clean
  
-    ClauseAllocator ca_shadow;                            // if clauses are changed, they are copied to ca_shadow, then changed from here
+    ClauseArena* arena;                                   // if clauses are changed, they are copied to the tree-wide arena (owned by the Solver), then changed from here
+    node_pool<shadow>* pool;                                    // the pool (owned by the Solver) that holds the memory of this shadow and its childern
+    ClauseArena::Chunks arena_chunks;                     // the arena chunks holding the clauses of this shadow (released when this shadow is destructed)
     std::unordered_map<CRef, CRef> cref_map;              // copied clauses often have new CRef. Use this as a mapping from old CRef to new CRef
     int ca_size;                                          // this tracks the size of ca of the parent (used as CRef when adding learnt clauses)
     const Clause& get_clause(CRef cr) const;              // this function gets a reference to Clause at CRef cr. No modification allowed.
@@ -138,13 +153,14 @@ public:
 
 
     // main functions:
-    bool     step             (Lit action, float* array);               // make a simulation step toward action, write state to array. return true of array is not empty
+    bool     step             (Lit action, state_out array);              // make a simulation step toward action, write state to array. return true of array is not empty
     CRef     propagate        ();                                       // Perform unit propagation. Returns possibly conflicting clause.
     void     analyze          (CRef confl, vec<Lit>& learnt, int& bt);  // (bt = backtrack)
     void     cancelUntil      (int level);                              // Backtrack until a certain level.
     void     reduceDB         ();                                       // Reduce the set of learnt clauses.
     bool     check_state      ();                                       // DEBUG! assume this shadow is the root_shadow, and check its state is consistent with the Solver 
     void     check_self       () const;                                 // DEBUG! check that this shadow object is self-coherant
+    static void report        (const char* format, ...);                // DEBUG! the message of a check that fails, to stderr in one piece
 
  
     // other helper functions
@@ -172,12 +188,17 @@ public:
     void     checkGarbage();
     uint32_t get_ca_size();
     void     relocAll (ClauseAllocator& to);
+
+    // memory accounting (for the memory budget of the Solver, see Solver::mctsBytes)
+    int64_t  footprint() const;                        // The bytes held by this shadow (itself, its dense copies and its maps), apart from the arena.
+    void     account  ();                              // Bring the count of this shadow in Solver::shadow_bytes up to its footprint().
+    int64_t  counted_bytes;                            // The bytes of this shadow in Solver::shadow_bytes (taken out by the destructor).
 };
 
 // inline helper functions
-inline int   shadow::nAssigns        ()      const { return trail_size; }
-inline void  shadow::newDecisionLevel()            { append_trail_lim(trail_size); }
-inline int   shadow::decisionLevel   ()      const { return trail_lim_size; }
+inline int   shadow::nAssigns        ()      const { return trail.size(); }
+inline void  shadow::newDecisionLevel()            { append_trail_lim(trail.size()); }
+inline int   shadow::decisionLevel   ()      const { return trail_lim.size(); }
 inline lbool shadow::value           (Var x) const { return get_assigns(x); } 
 inline lbool shadow::value           (Lit p) const { return get_assigns(var(p)) ^ sign(p); } 
 inline int   shadow::get_level       (Var x) const { return get_vardata(x).level; }
@@ -198,76 +219,52 @@ inline bool  shadow::locked          (const Clause& c) const {
 }    
 
 
-// inline functions for difference in state
-// IMPORTANT: if parent == NULL, origin must not be NULL, and differences in maps are ignored!! 
+// inline functions for the dense assignment snapshot
 inline Lit shadow::get_trail(int x) const { 
-    assert ( x < trail_size && "get_trail out of range");
-    const shadow* temp = this;
-    while(temp->trail_map.count(x) == 0 && temp-> parent != NULL) temp = temp->parent;
-    if (temp -> parent == NULL) return temp->origin->trail[x];
-    return temp->trail_map.at(x);
+    assert ( x < trail.size() && "get_trail out of range");
+    return trail[x];
 } 
 inline void shadow::append_trail(Lit y) {
-    trail_map[trail_size++] = y;
+    trail.push(y);
 } 
-inline void shadow::trail_map_clear_until(int x){
-    trail_size = x;
-    for(auto it = trail_map.begin(); it != trail_map.end(); )
-        if(it->first >= x)
-            it = trail_map.erase(it);
-        else
-            ++it;
+inline void shadow::trail_clear_until(int x){
+    trail.shrink(trail.size() - x);
 }
 
 inline int shadow::get_trail_lim(int x) const {
-    assert (x < trail_lim_size && "get_trail_lim out of range");
-    const shadow* temp = this;
-    while(temp->trail_lim_map.count(x) == 0 && temp -> parent != NULL) temp = temp -> parent;
-    if (temp -> parent == NULL) return temp-> origin -> trail_lim[x];
-    return temp -> trail_lim_map.at(x);
+    assert (x < trail_lim.size() && "get_trail_lim out of range");
+    return trail_lim[x];
 }
 inline void shadow::append_trail_lim(int y) {
-    trail_lim_map[trail_lim_size++] = y;
+    trail_lim.push(y);
 }
-inline void shadow::trail_lim_map_clear_until(int level) { // corresponding to trail_lim.shrink to level
-    trail_lim_size = level;
-    for (auto it = trail_lim_map.begin(); it != trail_lim_map.end(); )
-        if (it -> first >= level)
-            it = trail_lim_map.erase(it);
-        else
-            ++it;
+inline void shadow::trail_lim_clear_until(int level) { // corresponding to trail_lim.shrink to level
+    trail_lim.shrink(trail_lim.size() - level);
 } 
 
 inline lbool shadow::get_assigns(Var x) const { 
-    const shadow* temp = this;
-    while(temp->assigns_map.count(x) == 0 && temp->parent != NULL) temp = temp->parent;
-    if (temp -> parent == NULL) return temp->origin->assigns[x];
-    return temp->assigns_map.at(x);
+    return assigns[x];
 }
 inline void shadow::set_assigns(Var x, lbool y) {
-    assigns_map[x] = y;
+    assigns[x] = y;
 }
 
 inline Solver::VarData shadow::get_vardata(Var x) const {
-    const shadow* temp = this;
-    while (temp->vardata_map.count(x) == 0 && temp -> parent != NULL) temp = temp -> parent;
-    if (temp -> parent == NULL) return temp-> origin -> vardata[x];
-    return temp -> vardata_map.at(x);
+    return vardata[x];
 }
 inline void shadow::set_vardata(Var x, Solver::VarData data) {
-    vardata_map[x] = data;
+    vardata[x] = data;
 }
 
 inline char shadow::get_polarity(Var x) const {
-    const shadow* temp = this;
-    while (temp->polarity_map.count(x) == 0 && temp -> parent != NULL) temp = temp -> parent;
-    if (temp -> parent == NULL) return temp->origin->polarity[x];
-    return temp-> polarity_map.at(x);
+    return polarity[x];
 }
 inline void shadow::set_polarity(Var x, char y) {
-    polarity_map[x] = y;
+    polarity[x] = y;
 }
 
+// inline functions for difference in state
+// IMPORTANT: if parent == NULL, origin must not be NULL, and differences in maps are ignored!! 
 inline vec<Solver::Watcher>& shadow::get_watches_copied(Lit p_input) {
     int p = p_input.x;
     if (!watches_map.count(p)) {
@@ -276,32 +273,14 @@ inline vec<Solver::Watcher>& shadow::get_watches_copied(Lit p_input) {
         watches_map[p] = new vec<Solver::Watcher>();
         if (temp -> parent == NULL) {
         	temp->origin->watches.lookup(p_input).copyVstructTo(*watches_map.at(p)); 
-    		if (get_dirty(p_input) == assert_clean(*watches_map.at(p))) { // for debug, print something
-                printf("%d?%d", get_dirty(p_input), assert_clean(*watches_map.at(p))); fflush(stdout);
-            }	
+    		if (get_dirty(p_input) == assert_clean(*watches_map.at(p))) // for debug, print something
+                report("the watches of %d copied from the Solver: dirty %d, clean %d", p, get_dirty(p_input), assert_clean(*watches_map.at(p)));
             assert (get_dirty(p_input) != assert_clean(*watches_map.at(p)) && "get_dirty needs update 1!");
         } else {
         	temp->watches_map.at(p)->copyVstructTo(*watches_map.at(p)); 
 	    	if (get_dirty(p_input) == assert_clean(*watches_map.at(p))) { // for debug, print something
-                printf("%d?%d", get_dirty(p_input), assert_clean(*watches_map.at(p))); 
-                fflush(stdout);
-        		printf("source get_dirty is %d\n", temp -> get_dirty(p_input));
-        		vec<Solver::Watcher>& v1 = *(temp -> watches_map.at(p));
-        		vec<Solver::Watcher>& v2 = *watches_map.at(p);
-        		printf("source watches have size %d\n", v1.size());
-        		CRef prob = v1[0].cref;
-        		const shadow* ee = temp;
-        		while (ee->cref_map.count(prob) == 0 && ee->parent != NULL) ee = ee->parent;
-        		if (ee -> parent == NULL) printf("get from solver\n");
-        		else printf("get from shadow\n");
-        		for (int i = 0 ; i < v1.size(); i++) {
-        			printf("%d@%d ", v1[i].cref, temp -> get_clause(v1[i].cref).mark() );
-        		} 
-        		printf("here watches have size %d\n", v2.size());
-        		for (int i = 0; i < v2.size(); i++) {
-        			printf("%d@%d ", v2[i].cref, get_clause(v2[i].cref).mark() );
-        		}
-        		fflush(stdout);
+        		report("the watches of %d copied from an ancestor (dirty there %d, %d watches): dirty %d, clean %d", p,
+        		       temp -> get_dirty(p_input), temp -> watches_map.at(p) -> size(), get_dirty(p_input), assert_clean(*watches_map.at(p)));
         		temp -> check_self();
 			}	
 		    assert (get_dirty(p_input) != assert_clean(*watches_map.at(p)) && "get_dirty needs update 2!");
@@ -342,19 +321,20 @@ inline const Clause& shadow::get_clause(CRef cr) const {
     const shadow* temp = this;
     while (temp->cref_map.count(cr) == 0 && temp->parent != NULL) temp = temp->parent;
     if (temp -> parent == NULL) return temp->origin->ca[cr];
-    return temp->ca_shadow[temp->cref_map.at(cr)];
+    return (*temp->arena)[temp->cref_map.at(cr)];
 }
 inline Clause& shadow::get_clause_copied(CRef cr) {
-    if (cref_map.count(cr)) return ca_shadow[cref_map.at(cr)];
-    CRef mapped_cr = ca_shadow.alloc(get_clause(cr));
+    if (cref_map.count(cr)) return (*arena)[cref_map.at(cr)];
+    CRef mapped_cr = arena->alloc(arena_chunks, get_clause(cr));
     cref_map[cr] = mapped_cr;
-    return ca_shadow[mapped_cr];
+    return (*arena)[mapped_cr];
 }
 inline CRef shadow::get_alloc(const vec<Lit>& ps, bool learnt) {
     CRef outside_value = (CRef)ca_size;
-    CRef inside_value = ca_shadow.alloc(ps, learnt);
+    CRef inside_value = arena->alloc(arena_chunks, ps, learnt);
     cref_map[outside_value] = inside_value;
-    ca_size += (ca_shadow.size() - (uint32_t)inside_value);
+    const Clause& c = (*arena)[inside_value];
+    ca_size += ClauseAllocator::clauseWord32Size(c.size(), c.has_extra(), true); // (the size it has in the Solver, where it is counted)
     return outside_value;
 }
 
@@ -387,15 +367,46 @@ inline void shadow::get_copy_for_learnts() {
 }
 
 
+// a shadow below the root, with no clause learnt in the tree, has the clauses of the Solver: its state depends on assigns only
+inline bool shadow::transposable() const {
+    return parent != NULL && get_learnts_size() == solver -> learnts.size();
+}
+
+inline Solver* shadow::get_origin() const {
+    return solver;
+}
+
+inline int shadow::get_sat_count(CRef cr) const {
+    const shadow* temp = this;
+    while (temp -> sat_count_map.count(cr) == 0 && temp -> parent != NULL) temp = temp -> parent;
+    if (temp -> parent == NULL) return solver -> ca[cr].satCount();
+    return temp -> sat_count_map.at(cr);
+}
+inline bool shadow::satisfied(CRef cr) const {
+    return cr < counted ? get_sat_count(cr) > 0 : satisfied(get_clause(cr));
+}
+inline bool shadow::newly_satisfied(CRef cr) const {
+    if (cr >= counted) return satisfied(get_clause(cr));
+    std::unordered_map<CRef, int>::const_iterator it = sat_count_map.find(cr);
+    return it != sat_count_map.end() && it -> second > 0;
+}
+inline void shadow::update_sat_count(Lit p, int delta) {
+    const vec<CRef>& cs = solver -> lit_occurs.lookup(p);
+    for (int i = 0; i < cs.size(); i++) {
+        if (cs[i] >= counted) continue;
+        std::unordered_map<CRef, int>::iterator it = sat_count_map.find(cs[i]);
+        if (it == sat_count_map.end()) sat_count_map.emplace(cs[i], get_sat_count(cs[i]) + delta);
+        else                           it -> second += delta;
+    }
+}
+
 // Memory management functions (currently disabled)
 inline uint32_t shadow::get_ca_size() {
-    shadow* temp = this;
-    while(temp->parent != NULL) temp = temp-> parent;
-    return temp->origin->ca.size();
+    return solver->ca.size();
 }
 inline void shadow::checkGarbage(void){ return checkGarbage(garbage_frac); }
 inline void shadow::checkGarbage(double gf){ 
-    if (ca_shadow.wasted() > (ca_shadow.size() + get_ca_size()) * gf)
+    if (arena->wasted() > (arena->size() + get_ca_size()) * gf)
         garbageCollect(); 
     }
 }
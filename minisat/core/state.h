@@ -0,0 +1,142 @@
+#ifndef Minisat_state_h
+#define Minisat_state_h
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "minisat/core/SolverTypes.h"
+#include "minisat/core/Const.h"
+
+namespace Minisat {
+
+// the splitmix64 finalizer: a cheap mix of 64 bits, for the hashes of assignments (see zobrist()) and states (see state_writer::key)
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// state_out -- where a state is written: the float tensor, the packed bytes (see state_writer), or nowhere
+struct state_out {
+    float*   array;
+    uint8_t* packed;
+
+    state_out(float* array = NULL) : array(array), packed(NULL) {}
+    static state_out packed_to(uint8_t* packed) { state_out out; out.packed = packed; return out; }
+    bool nowhere() const { return array == NULL && packed == NULL; }
+};
+
+// state_dims -- the size of the states of one Solver, set per instance before its first state is written
+// (the problem must have at most dim1 variables, and dim1 at most Hyper_Const::max_nact / 2)
+struct state_dims {
+    int dim0;                      // max number of clauses in a state (the rest is cut off)
+    int dim1;                      // max number of variables
+
+    state_dims(int dim0 = Hyper_Const::dim0, int dim1 = Hyper_Const::dim1) : dim0(dim0), dim1(dim1) {}
+    int  nact       () const { return dim1 * Hyper_Const::dim2; }    // the actions are the literals
+    int  size       () const { return dim0 * nact(); }               // number of floats in a state
+    int  col_words  () const { return (nact() + 63) / 64; }          // number of 64 bit words in the bit mask of a column
+    int  col_bytes  () const { return (nact() + 7) / 8; }
+    int  packed_size() const { return (dim0 + 1) * col_bytes(); }    // number of bytes in a packed state
+
+    state_out nth   (state_out out, int i) const {                   // the i-th of a batch of states at out
+        if (out.array  != NULL) out.array  += i * size();
+        if (out.packed != NULL) out.packed += i * packed_size();
+        return out; }
+
+    void move(state_out out, int from, int to) const {               // move the from-th state of a batch at out to the to-th (which
+        state_out a = nth(out, from), b = nth(out, to);              // must be zero), and leave the from-th zero
+        if (out.array  != NULL) { memcpy(b.array,  a.array,  size() * sizeof(float)); memset(a.array,  0, size() * sizeof(float)); }
+        if (out.packed != NULL) { memcpy(b.packed, a.packed, packed_size());          memset(a.packed, 0, packed_size()); } }
+
+    void clear(state_out out, int i) const {                         // zero the i-th state of a batch at out
+        state_out a = nth(out, i);
+        if (out.array  != NULL) memset(a.array,  0, size() * sizeof(float));
+        if (out.packed != NULL) memset(a.packed, 0, packed_size()); }
+
+    void mark_valid(const uint64_t* mask, bool* valid) const {       // set valid[a] for every action a in mask
+        for (int a = 0; a < nact(); a++)
+            if ((mask[a >> 6] >> (a & 63)) & 1) valid[a] = true; }
+};
+
+// the W of state_writer for dims: 1 for up to 32 variables (uf20), 2 for up to 64 (uf50), 4 for up to 128 (uf100)
+static_assert(Hyper_Const::max_nact <= 4 * 64, "the states of max_nact actions need a wider state_writer");
+inline int state_words(const state_dims& dims) { return dims.col_words() <= 2 ? dims.col_words() : 4; }
+
+// state_writer -- the one kernel that writes a state for the RL algorithm (by the Solver, or by a shadow in MCTS)
+//
+// The state is a tensor of dim0 x dim1 x dim2 floats, zeroed by the caller. Each column is one clause that is not satisfied,
+// with a 1 at (col, var, sign) for every literal of it that is not false. With dim2 == 2, the offset of a literal in its column
+// is toInt(lit), which is also the index of its action. So the valid actions (the literals in the state) are collected as one
+// bit mask in the same pass that writes the columns, and valid[] is filled from that mask once, at the end.
+//
+// The packed format holds the same 0/1 values in packed_size() bytes (also zeroed by the caller): column 'col' is the bytes
+// [col * col_bytes, (col + 1) * col_bytes), with entry toInt(lit) at bit (toInt(lit) % 8) of its byte (numpy.unpackbits with
+// bitorder='little'), and the valid actions follow as one more "column" of nact bits.
+//
+// key() is a 64 bit hash of the state written (of its columns in order, and of the dims), by which the evaluations of the network
+// are cached (see eval_cache.h). It is folded in as the columns are written, whether or not they are written anywhere.
+//
+// W is the number of 64 bit words of a column mask (at least dims.col_words()), so that the hot loop is specialized for the
+// common sizes of problems (see state_words()).
+template<int W>
+class state_writer {
+public:
+    state_writer(state_out out, const state_dims& dims);
+
+    template<class S>
+    void write (const S& s, const Clause& c);   // write one clause that is not satisfied in the assignment of s (Solver or shadow)
+    bool full  () const { return cols >= dim0; }
+    int  size  () const { return cols; }        // number of columns (clauses) written
+    uint64_t key() const { return hash; }       // the hash of the state written so far
+    const uint64_t* valid_mask() const { return mask; }
+    void finish() {                             // after the last clause: write the valid actions (packed format only)
+        if (out.packed != NULL) store(out.packed + dim0 * col_bytes, mask); }
+
+private:
+    static_assert(Hyper_Const::dim2 == 2, "the offset of a literal in its column must be toInt(lit)");
+
+    void store(uint8_t* bytes, const uint64_t* bits) const {
+        for (int i = 0; i < col_bytes; i++) bytes[i] = (uint8_t)(bits[i >> 3] >> ((i & 7) * 8)); }
+
+    state_out out;
+    int       dim0;
+    int       col_floats;
+    int       col_bytes;
+    int       cols;
+    uint64_t  hash;
+    uint64_t  mask[W];
+};
+
+template<int W>
+inline state_writer<W>::state_writer(state_out out, const state_dims& dims) :
+    out(out), dim0(dims.dim0), col_floats(dims.nact()), col_bytes(dims.col_bytes()), cols(0),
+    hash(mix64((uint64_t)dims.dim0 << 32 | (uint32_t)dims.dim1))
+{
+    assert(dims.col_words() <= W);
+    for (int i = 0; i < W; i++) mask[i] = 0;
+}
+
+template<int W>
+template<class S>
+inline void state_writer<W>::write(const S& s, const Clause& c) {
+    assert(!full());
+    float*   a = out.array == NULL ? NULL : out.array + cols * col_floats;
+    uint64_t col[W] = {};
+    for (int i = 0; i < c.size(); i++)
+        if (s.value(c[i]) != l_False) {
+            int x = toInt(c[i]);
+            assert(x < col_floats && "a variable of the problem is out of the state (dim1)");
+            if (a != NULL) a[x] = 1.0;
+            col[x >> 6] |= (uint64_t)1 << (x & 63);
+        }
+    if (out.packed != NULL) store(out.packed + cols * col_bytes, col);
+    for (int i = 0; i < W; i++) { mask[i] |= col[i]; hash = mix64(hash ^ col[i]); }
+    cols++;
+}
+
+}
+
+#endif
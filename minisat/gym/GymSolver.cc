@@ -1,11 +1,16 @@
 #include <errno.h>
 #include <zlib.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "minisat/utils/System.h"
 #include "minisat/utils/ParseUtils.h"
 #include "minisat/utils/Options.h"
 #include "minisat/core/Dimacs.h"
 #include "minisat/simp/SimpSolver.h"
+#include "minisat/core/state.h"
 #include "minisat/gym/GymSolver.h"
 
 using namespace Minisat;
@@ -13,42 +18,399 @@ using namespace Minisat;
 //=================================================================================================
 // Constructor/Destructor:
 
-GymSolver::GymSolver(char* sat_prob) {
-    
-	IntOption    verb   ("MAIN", "verb",   "Verbosity level (0=silent, 1=some, 2=more).", 0, IntRange(0, 2));
-	S.verbosity = verb;
+GymSolver::GymSolver(char* sat_prob) : building(false) {
+    load(sat_prob, NULL);
+}
+
+GymSolver::GymSolver(char* sat_prob, int max_clause, int max_var, int mcts_size) :
+    GymSolver(sat_prob, max_clause, max_var, mcts_size, NULL) {}
+
+GymSolver::GymSolver(char* sat_prob, int max_clause, int max_var, int mcts_size, ProblemCache* cache) : building(false) {
+    set_dims(max_clause, max_var, mcts_size);
+    load(sat_prob, cache);
+}
+
+GymSolver::GymSolver(Corpus* corpus, int problem, int max_clause, int max_var, int mcts_size) : building(false) {
+    set_dims(max_clause, max_var, mcts_size);
+    load(corpus, problem);
+}
+
+GymSolver::GymSolver(int max_clause, int max_var, int mcts_size) : building(true) {
+    set_dims(max_clause, max_var, mcts_size);
+    S.verbosity = 0;
+}
+
+GymSolver::GymSolver(int* clauses, int c, int max_clause, int max_var, int mcts_size) :
+    GymSolver(max_clause, max_var, mcts_size) {
+    add_clauses(clauses, c);
+}
+
+void GymSolver::set_dims(int max_clause, int max_var, int mcts_size) {
+    if (max_clause < 1 || max_var < 1 || max_var * Hyper_Const::dim2 > Hyper_Const::max_nact || mcts_size < 1)
+        throw std::invalid_argument("max_clause, max_var or mcts_size is out of range (max_var is at most Hyper_Const::max_nact / 2)");
+    S.dims = state_dims(max_clause, max_var);
+    S.mcts_size_lim = mcts_size;
+}
+
+// (a file that can not be read, or a problem that is UNSAT by simplification, is a ValueError for the caller, not the end of the process:
+// the GymSolvers of several threads may be made at once)
+static void read_problem(char* sat_prob, SimpSolver& S) {
 	gzFile in = gzopen(sat_prob, "rb");
-    if (in == NULL) {
-    	printf("ERROR! Could not open file: %s\n", sat_prob);
-    	exit(1);
-    }
+    if (in == NULL)
+    	throw std::invalid_argument(std::string("could not open file: ") + sat_prob);
     parse_DIMACS(in, S, true);
     gzclose(in);
+}
+
+static void simplify_problem(const char* sat_prob, SimpSolver& S) {
+    S.eliminate(true);
+    if (!S.okay())
+    	throw std::invalid_argument(std::string("the SAT problem from file: ") + sat_prob + " is UNSAT by simplification");
+}
+
+void GymSolver::load(char* sat_prob, ProblemCache* cache) {
+	// the solver is silent (verbosity 0). No Option is made here: an Option registers itself in a global list, and the GymSolvers
+	// of several threads are made at once
+	S.verbosity = 0;
     asprintf(&(S.snapTo), "%s%s", sat_prob, "snaps");
 
+    if (cache == NULL) {
+        read_problem(sat_prob, S);
+        if (S.nVars() > S.dims.dim1)
+            throw std::invalid_argument("the SAT problem has more variables than max_var");
+        simplify_problem(sat_prob, S);
+        return;
+    }
+
+    // the problem is read and simplified once, and copied by the GymSolvers of it (it is never changed once it is in the cache,
+    // and it is cached for the GymSolvers of a larger max_var even if it does not fit this one)
+    problem_cache::version version;
+    problem_cache::problem problem = cache -> C.find(sat_prob, version);
+    if (!problem) {
+        std::shared_ptr<SimpSolver> parsed = std::make_shared<SimpSolver>();
+        parsed -> verbosity = 0;
+        read_problem(sat_prob, *parsed);
+        simplify_problem(sat_prob, *parsed);
+        cache -> C.insert(sat_prob, version, parsed);
+        problem = parsed;
+    }
+    if (problem -> nVars() > S.dims.dim1)
+        throw std::invalid_argument("the SAT problem has more variables than max_var");
+    S.copyProblem(*problem);
+}
+
+static void check_problem(const corpus_reader& R, int problem) {
+    if (problem < 0 || problem >= R.size()) throw std::out_of_range("the problem is out of the corpus");
+}
+
+// add the clauses of the literals (in DIMACS, each clause ended by 0) to S, as parse_DIMACS adds those of a file: a variable is
+// made when a literal of it (or of a larger one) is first met. The literals must be of the variables 1 .. vars.
+static void add_problem(SimpSolver& S, const int32_t* lits, int64_t n, int vars) {
+    vec<Lit> ps;
+    for (int64_t i = 0; i < n; i++) {
+        if (lits[i] == 0) { S.addClause_(ps); ps.clear(); continue; }
+        if (lits[i] < -vars || lits[i] > vars) throw std::invalid_argument("a literal of the problem is not of its variables");
+        Var v = abs(lits[i]) - 1;
+        while (v >= S.nVars()) S.newVar();
+        ps.push(mkLit(v, lits[i] < 0));
+    }
+}
+
+void GymSolver::load(Corpus* corpus, int problem) {
+	S.verbosity = 0;
+    const corpus_reader& R = corpus -> R;
+    check_problem(R, problem);
+    asprintf(&(S.snapTo), "%s%s", R.name(problem), "snaps");
+    if (R.vars(problem) > S.dims.dim1)
+        throw std::invalid_argument("the SAT problem has more variables than max_var");
+
+    if (!R.simplified()) {
+        add_problem(S, R.literals(problem), R.n_literals(problem), R.vars(problem));
+        simplify_problem(R.name(problem), S);
+        return;
+    }
+
+    // a simplified problem: its clauses are added as they are, and eliminate(true) only turns the simplification off (it eliminates
+    // no variable, and no clause subsumes another), which leaves the solver as the simplification of its file did. The variables that
+    // are in none of the clauses (those eliminated) are not decision variables, as after the simplification.
+    const int32_t* lits = R.literals(problem);
+    int64_t        n    = R.n_literals(problem);
+    vec<char>      occurs(R.vars(problem), 0);
+    for (int64_t i = 0; i < n; i++)
+        if (lits[i] != 0 && lits[i] >= -R.vars(problem) && lits[i] <= R.vars(problem)) occurs[abs(lits[i]) - 1] = 1;
+    for (int v = 0; v < R.vars(problem); v++) S.newVar(l_Undef, occurs[v]);
+    add_problem(S, lits, n, R.vars(problem));
+    S.use_elim        = false;
+    S.subsumption_lim = 0;
+    simplify_problem(R.name(problem), S);
+}
+
+// the clauses are checked first (so that none is added if one is wrong), and counted for one reservation of their memory
+void GymSolver::add_clauses(int* clauses, int c) {
+    if (!building) throw std::invalid_argument("clauses are added only to a problem made in memory, before its init()");
+    int n = 0;
+    for (int i = 0; i < c; i++)
+        if (clauses[i] == 0) n++;
+        else if (clauses[i] < -S.dims.dim1 || clauses[i] > S.dims.dim1)
+            throw std::invalid_argument("a literal is not of the variables 1 .. max_var");
+    if (c > 0 && clauses[c - 1] != 0) throw std::invalid_argument("the last clause is not ended by 0");
+    S.reserveClauses(n, c - n);
+    add_problem(S, clauses, c, S.dims.dim1);
+}
+
+void GymSolver::finish_problem() {
+    if (!building) return;
+    building = false;
     S.eliminate(true);
-    if (!S.okay()){
-    	printf("ERROR! SAT problem from file: %s is UNSAT by simplification\n", sat_prob);
-    	exit(1);    
-    }    
+    if (!S.okay()) throw std::invalid_argument("the SAT problem is UNSAT by simplification");
+}
+
+//=================================================================================================
+// The sizes of the arrays (they depend on the dims of this instance):
+
+static void check_size(int n, int size, const char* what) {
+    if (n < size) throw std::invalid_argument(what);
+}
+
+// the leaves of this move are evaluated by the caller of simulate (not in a move of simulate_native)
+static void evaluated_by_caller(SimpSolver& S) {
+    if (S.mcts_evaluator == Solver::eval_native)
+        throw std::invalid_argument("simulate can not go on with the search of simulate_native in the same move");
+    S.mcts_evaluator = Solver::eval_caller;
+}
+
+int GymSolver::state_size() {
+    return S.dims.size();
+}
+
+int GymSolver::packed_size() {
+    return S.dims.packed_size();
 }
 
+//=================================================================================================
+// Environment:
+
 bool GymSolver::init(float* array, int n) {
     // Comments by Fei: Now the solveLimited() function really just initialize the problem. It needs steps to finish up!
     vec<Lit> dummy;
+    check_size(n, S.dims.size(), "the state needs GymSolver.state_size() floats");
+    finish_problem();
     S.write_state_to = array;
     S.solveLimited(dummy);
     return S.env_hold; // return false if the problem is finished by simplification
 }
 
 int GymSolver::simulate(float* array, int n, float* pi, int m, float* v, int t) {
+    check_size(n, S.dims.size(), "the state needs GymSolver.state_size() floats");
+    check_size(m, S.dims.nact(), "pi needs max_var * 2 floats");
+    check_size(t, 1, "v needs one float");
+    evaluated_by_caller(S);
     return S.simulate(array, pi, v[0]);
 }
 
+// the return code of the batched simulate (the batch size is the number of whole states in the space given)
+static int batch_code(int leaves, bool more) {
+    return leaves * 2 + int(more);
+}
+
+int GymSolver::simulate_batch(float* array, int n, float* pi, int m, float* v, int t) {
+    check_size(n, S.dims.size(), "the states need at least GymSolver.state_size() floats");
+    check_size(m, S.waiting_leaves() * S.dims.nact(), "pi needs max_var * 2 floats for each waiting state");
+    check_size(t, S.waiting_leaves(), "v needs one float for each waiting state");
+    evaluated_by_caller(S);
+    bool more;
+    int  leaves = S.simulate_batch(array, n / S.dims.size(), pi, v, more);
+    return batch_code(leaves, more);
+}
+
+int GymSolver::get_waiting() {
+    return S.waiting_leaves();
+}
+
+int GymSolver::simulate_native(int prior, int k) {
+    if (prior < Solver::prior_uniform || prior > Solver::prior_model) throw std::invalid_argument("the prior must be 0, 1, 2, 3 or 4");
+    if (prior == Solver::prior_model && S.nn_net == NULL) throw std::invalid_argument("simulate_native(4) needs a model (see use_model)");
+    if (k < 1) throw std::invalid_argument("the batch of simulate_native must be at least 1");
+    return S.simulate_native(prior, k);
+}
+
 void GymSolver::get_visit_count(float* array, int n){
+    check_size(n, S.dims.nact(), "the visit count needs max_var * 2 floats");
     S.get_visit_count(array);
 }
 
+int GymSolver::get_proven_action() {
+    return S.get_proven_action();
+}
+
+void GymSolver::use_replay(bool replay) {
+    S.mcts_replay = replay;
+}
+
+void GymSolver::use_threads(int threads) {
+    if (threads < 1) throw std::invalid_argument("the number of MCTS threads must be at least 1");
+    S.mcts_threads = threads;
+}
+
+void GymSolver::use_trees(int trees) {
+    if (trees < 1) throw std::invalid_argument("the number of MCTS trees must be at least 1");
+    S.mcts_trees = trees;
+}
+
+void GymSolver::use_transpositions(bool transpose) {
+    S.mcts_transpose = transpose;
+}
+
+void GymSolver::use_cache(EvalCache* cache) {
+    S.nn_cache = cache == NULL ? NULL : &cache -> C;
+}
+
+void GymSolver::use_model(NNModel* model) {
+    if (model != NULL && !model -> M.fits(S.dims))
+        throw std::invalid_argument("the model is not for the states of max_clause x max_var x 2 of this GymSolver");
+    S.nn_net = model == NULL ? NULL : &model -> M;
+}
+
+void GymSolver::set_budget(double ms, long long propagations, long long bytes) {
+    S.setMctsTimeBudget(ms < 0 ? -1 : ms / 1000);
+    S.setMctsPropBudget(propagations < 0 ? -1 : propagations);
+    S.setMctsMemBudget(bytes < 0 ? -1 : bytes);
+}
+
+void GymSolver::seed(long long seed) {
+    Hyper_Const::seed_dirichlet((unsigned long)seed);
+}
+
+int GymSolver::get_simulations() {
+    return S.mctsSimulations();
+}
+
+//=================================================================================================
+// The cache of evaluations:
+
+EvalCache::EvalCache(int capacity) : C(capacity < 1 ? 1 : capacity) {
+    if (capacity < 1) throw std::invalid_argument("the capacity of the cache must be at least 1");
+}
+
+int       EvalCache::size    () { return C.size(); }
+int       EvalCache::capacity() { return C.capacity(); }
+long long EvalCache::hits    () { return C.hits(); }
+long long EvalCache::misses  () { return C.misses(); }
+void      EvalCache::clear   () { C.clear(); }
+
+ProblemCache::ProblemCache(int capacity) : C(capacity < 1 ? 1 : capacity) {}
+
+int       ProblemCache::size    () { return C.size(); }
+int       ProblemCache::capacity() { return C.capacity(); }
+long long ProblemCache::hits    () { return C.hits(); }
+long long ProblemCache::misses  () { return C.misses(); }
+void      ProblemCache::clear   () { C.clear(); }
+
+Corpus::Corpus(char* path) {
+    const char* error = R.open(path);
+    if (error != NULL) throw std::invalid_argument(error);
+}
+
+int         Corpus::size      ()            { return R.size(); }
+bool        Corpus::simplified()            { return R.simplified(); }
+const char* Corpus::name      (int problem) { check_problem(R, problem); return R.name(problem); }
+int         Corpus::vars      (int problem) { check_problem(R, problem); return R.vars(problem); }
+int         Corpus::clauses   (int problem) { check_problem(R, problem); return R.clauses(problem); }
+int         Corpus::find      (char* name)  { return R.find(name); }
+
+//=================================================================================================
+// The network:
+
+NNModel::NNModel(char* path) {
+    const char* error = M.load(path);
+    if (error != NULL) throw std::invalid_argument(error);
+}
+
+int NNModel::input_size() { return M.input_size(); }
+int NNModel::nact      () { return M.nact(); }
+
+void NNModel::evaluate(float* array, int n, float* pi, int m, float* v, int t) {
+    int k = n / M.input_size();
+    check_size(m, k * M.nact(), "pi needs nact() floats for each state");
+    check_size(t, k, "v needs one float for each state");
+    M.evaluate(array, k, pi, v);
+}
+
+//=================================================================================================
+// The training records:
+
+RecordWriter::RecordWriter(char* path, int max_clause, int max_var) {
+    if (max_clause < 1 || max_var < 1 || max_var > Hyper_Const::max_nact / 2)
+        throw std::invalid_argument("max_clause or max_var is out of range (max_var is at most Hyper_Const::max_nact / 2)");
+    const char* error = W.open(path, state_dims(max_clause, max_var));
+    if (error != NULL) throw std::invalid_argument(error);
+}
+
+void RecordWriter::add(unsigned char* obs, int n, float* pi, int m, float value, int instance, int step) {
+    check_size(n, packed_size(), "the state needs RecordWriter.packed_size() bytes");
+    check_size(m, nact(), "pi needs RecordWriter.nact() floats");
+    W.add(obs, pi, value, instance, step);
+}
+
+void RecordWriter::flush() {
+    const char* error = W.flush();
+    if (error != NULL) throw std::invalid_argument(error);
+}
+
+void RecordWriter::close() {
+    if (W.opened()) flush();
+    W.close();
+}
+
+int       RecordWriter::pending    () { return W.pending(); }
+long long RecordWriter::written    () { return W.written(); }
+int       RecordWriter::packed_size() { return W.get_format().dims.packed_size(); }
+int       RecordWriter::nact       () { return W.get_format().dims.nact(); }
+
+RecordReader::RecordReader(char* path) {
+    const char* error = R.open(path);
+    if (error != NULL) throw std::invalid_argument(error);
+}
+
+long long RecordReader::size() { return R.size(); }
+
+long long RecordReader::refresh() {
+    const char* error = R.refresh();
+    if (error != NULL) throw std::invalid_argument(error);
+    return R.size();
+}
+
+int RecordReader::max_clause () { return R.get_format().dims.dim0; }
+int RecordReader::max_var    () { return R.get_format().dims.dim1; }
+int RecordReader::packed_size() { return R.get_format().dims.packed_size(); }
+int RecordReader::nact       () { return R.get_format().dims.nact(); }
+
+void RecordReader::gather(long long* index, int k, unsigned char* obs, int n, float* pi, int m, float* v, int t, int* info, int l) {
+    int ps = packed_size(), na = nact();
+    check_size(n, k * ps, "obs needs packed_size() bytes for each record");
+    check_size(m, k * na, "pi needs nact() floats for each record");
+    check_size(t, k, "v needs one float for each record");
+    check_size(l, 2 * k, "info needs two ints for each record");
+    for (int i = 0; i < k; i++)
+        if (index[i] < 0 || index[i] >= R.size()) throw std::out_of_range("the index of a record is out of range");
+    for (int i = 0; i < k; i++) {
+        memcpy(obs + i * ps, R.packed(index[i]), ps);
+        memcpy(pi + i * na, R.pi(index[i]), na * sizeof(float));
+        v[i] = R.value(index[i]);
+        info[2 * i]     = R.instance(index[i]);
+        info[2 * i + 1] = R.step(index[i]);
+    }
+}
+
+void RecordReader::sample(long long seed, unsigned char* obs, int n, float* pi, int m, float* v, int t, int* info, int l) {
+    if (R.size() == 0) throw std::invalid_argument("there are no records to sample");
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<long long> pick(0, R.size() - 1);
+    std::vector<long long> index(t);
+    for (int i = 0; i < t; i++) index[i] = pick(rng);
+    gather(index.data(), t, obs, n, pi, m, v, t, info, l);
+}
+
 void GymSolver::set_decision(int decision) {
     if (decision < 0) {
         S.agent_decision = S.default_pickLit();
@@ -58,6 +420,7 @@ void GymSolver::set_decision(int decision) {
 }
 
 void GymSolver::step(float* array, int n) {
+    check_size(n, S.dims.size(), "the state needs GymSolver.state_size() floats");
     S.write_state_to = array;
     S.step();
     /*
@@ -75,6 +438,43 @@ void GymSolver::step_forward(int decision) {
     S.step();
 }
 
+//=================================================================================================
+// Packed states:
+
+static state_out packed(const SimpSolver& S, unsigned char* obs, int n) {
+    check_size(n, S.dims.packed_size(), "the packed state needs GymSolver.packed_size() bytes");
+    return state_out::packed_to(obs);
+}
+
+bool GymSolver::init_packed(unsigned char* obs, int n) {
+    vec<Lit> dummy;
+    S.write_state_to = packed(S, obs, n);
+    finish_problem();
+    S.solveLimited(dummy);
+    return S.env_hold;
+}
+
+int GymSolver::simulate_packed(unsigned char* obs, int n, float* pi, int m, float* v, int t) {
+    check_size(m, S.dims.nact(), "pi needs max_var * 2 floats");
+    check_size(t, 1, "v needs one float");
+    evaluated_by_caller(S);
+    return S.simulate(packed(S, obs, n), pi, v[0]);
+}
+
+int GymSolver::simulate_batch_packed(unsigned char* obs, int n, float* pi, int m, float* v, int t) {
+    check_size(m, S.waiting_leaves() * S.dims.nact(), "pi needs max_var * 2 floats for each waiting state");
+    check_size(t, S.waiting_leaves(), "v needs one float for each waiting state");
+    evaluated_by_caller(S);
+    bool more;
+    int  leaves = S.simulate_batch(packed(S, obs, n), n / S.dims.packed_size(), pi, v, more);
+    return batch_code(leaves, more);
+}
+
+void GymSolver::step_packed(unsigned char* obs, int n) {
+    S.write_state_to = packed(S, obs, n);
+    S.step();
+}
+
 double GymSolver::get_reward() {
 	return S.env_reward;
 }
@@ -88,3 +488,183 @@ char* GymSolver::get_state() {
     return S.env_state;
 }
 
+
+//=================================================================================================
+// The batch of environments:
+
+GymSolverBatch::GymSolverBatch(int n, int max_clause, int max_var, int mcts_size) :
+    envs(n < 0 ? 0 : n, (GymSolver*)NULL), dim0(max_clause), dim1(max_var), size_lim(mcts_size), replay(false), cache(NULL), model(NULL),
+    problems(NULL), budget_ms(-1), budget_props(-1), budget_bytes(-1)
+{
+    if (n < 1) throw std::invalid_argument("a batch needs at least one environment");
+    if (max_clause < 1 || max_var < 1 || max_var > Hyper_Const::max_nact / 2 || mcts_size < 1)
+        throw std::invalid_argument("max_clause, max_var or mcts_size is out of range (max_var is at most Hyper_Const::max_nact / 2)");
+}
+
+GymSolverBatch::~GymSolverBatch() {
+    for (int i = 0; i < (int)envs.size(); i++) delete envs[i];
+}
+
+GymSolver& GymSolverBatch::env(int i) {
+    if (i < 0 || i >= (int)envs.size()) throw std::out_of_range("the environment is out of the batch");
+    if (envs[i] == NULL) throw std::invalid_argument("an environment of the batch has no problem yet (see load)");
+    return *envs[i];
+}
+
+int GymSolverBatch::size       () { return envs.size(); }
+int GymSolverBatch::state_size () { return state_dims(dim0, dim1).size(); }
+int GymSolverBatch::packed_size() { return state_dims(dim0, dim1).packed_size(); }
+int GymSolverBatch::nact       () { return state_dims(dim0, dim1).nact(); }
+
+void GymSolverBatch::place(int i, GymSolver* g) {
+    g -> use_replay(replay);
+    g -> use_cache(cache);
+    if (model != NULL) g -> use_model(model);
+    g -> set_budget(budget_ms, budget_props, budget_bytes);
+    delete envs[i];
+    envs[i] = g;
+}
+
+void GymSolverBatch::load(int i, char* sat_prob) {
+    if (i < 0 || i >= (int)envs.size()) throw std::out_of_range("the environment is out of the batch");
+    place(i, new GymSolver(sat_prob, dim0, dim1, size_lim, problems));
+}
+
+void GymSolverBatch::load(int i, Corpus* corpus, int problem) {
+    if (i < 0 || i >= (int)envs.size()) throw std::out_of_range("the environment is out of the batch");
+    place(i, new GymSolver(corpus, problem, dim0, dim1, size_lim));
+}
+
+void GymSolverBatch::load(int i, int* clauses, int c) {
+    if (i < 0 || i >= (int)envs.size()) throw std::out_of_range("the environment is out of the batch");
+    place(i, new GymSolver(clauses, c, dim0, dim1, size_lim));
+}
+
+void GymSolverBatch::use_threads(int threads) {
+    if (threads < 1) throw std::invalid_argument("the number of threads must be at least 1");
+    team.resize(threads);
+}
+
+void GymSolverBatch::use_replay(bool r) {
+    replay = r;
+    for (int i = 0; i < (int)envs.size(); i++) if (envs[i] != NULL) envs[i] -> use_replay(r);
+}
+
+void GymSolverBatch::use_cache(EvalCache* c) {
+    cache = c;
+    for (int i = 0; i < (int)envs.size(); i++) if (envs[i] != NULL) envs[i] -> use_cache(c);
+}
+
+void GymSolverBatch::use_model(NNModel* m) {
+    if (m != NULL && !m -> M.fits(state_dims(dim0, dim1)))
+        throw std::invalid_argument("the model is not for the states of max_clause x max_var x 2 of this batch");
+    model = m;
+    for (int i = 0; i < (int)envs.size(); i++) if (envs[i] != NULL) envs[i] -> use_model(m);
+}
+
+void GymSolverBatch::use_problems(ProblemCache* p) {
+    problems = p;
+}
+
+void GymSolverBatch::set_budget(double ms, long long propagations, long long bytes) {
+    budget_ms = ms; budget_props = propagations; budget_bytes = bytes;
+    for (int i = 0; i < (int)envs.size(); i++) if (envs[i] != NULL) envs[i] -> set_budget(ms, propagations, bytes);
+}
+
+void GymSolverBatch::init(float* array, int n) {
+    int N = envs.size(), size = state_size();
+    check_size(n, N * size, "the states need GymSolverBatch.size() * state_size() floats");
+    for (int i = 0; i < N; i++) env(i);
+    memset(array, 0, N * size * sizeof(float));
+    team.run(N, [&](int i) { envs[i] -> init(array + i * size, size); });
+}
+
+void GymSolverBatch::step(int* actions, int a, float* array, int n) {
+    int N = envs.size(), size = state_size();
+    check_size(a, N, "step needs one action for each environment");
+    check_size(n, N * size, "the states need GymSolverBatch.size() * state_size() floats");
+    for (int i = 0; i < N; i++) env(i);
+    memset(array, 0, N * size * sizeof(float));
+    team.run(N, [&](int i) {
+        if (envs[i] -> get_done()) return;
+        envs[i] -> set_decision(actions[i]);
+        envs[i] -> step(array + i * size, size);
+    });
+}
+
+int GymSolverBatch::simulate(float* array, int n, float* pi, int m, float* v, int t, int* info, int l) {
+    int N = envs.size(), size = state_size(), na = nact();
+    check_size(n, N * size, "the states need GymSolverBatch.size() * state_size() floats");
+    check_size(m, N * na, "pi needs nact() floats for each environment");
+    check_size(t, N, "v needs one float for each environment");
+    check_size(l, N, "info needs one int for each environment");
+    for (int i = 0; i < N; i++) env(i);
+    memset(array, 0, N * size * sizeof(float));
+    team.run(N, [&](int i) {
+        info[i] = envs[i] -> get_done() ? 0 : envs[i] -> simulate(array + i * size, size, pi + i * na, na, v + i, 1);
+    });
+    int more = 0;
+    for (int i = 0; i < N; i++) more += info[i] != 0;
+    return more;
+}
+
+void GymSolverBatch::simulate_native(int prior, int k) {
+    int N = envs.size();
+    for (int i = 0; i < N; i++) env(i);
+    team.run(N, [&](int i) { if (!envs[i] -> get_done()) envs[i] -> simulate_native(prior, k); });
+}
+
+void GymSolverBatch::get_visit_count(float* array, int n) {
+    int N = envs.size(), na = nact();
+    check_size(n, N * na, "the visit counts need GymSolverBatch.size() * nact() floats");
+    for (int i = 0; i < N; i++) env(i);
+    memset(array, 0, N * na * sizeof(float));
+    team.run(N, [&](int i) { if (!envs[i] -> get_done()) envs[i] -> get_visit_count(array + i * na, na); });
+}
+
+void GymSolverBatch::get_reward(float* array, int n) {
+    check_size(n, envs.size(), "the rewards need GymSolverBatch.size() floats");
+    for (int i = 0; i < (int)envs.size(); i++) array[i] = env(i).get_reward();
+}
+
+void GymSolverBatch::get_done(int* info, int l) {
+    check_size(l, envs.size(), "done needs GymSolverBatch.size() ints");
+    for (int i = 0; i < (int)envs.size(); i++) info[i] = env(i).get_done();
+}
+
+void GymSolverBatch::init_packed(unsigned char* obs, int n) {
+    int N = envs.size(), size = packed_size();
+    check_size(n, N * size, "the states need GymSolverBatch.size() * packed_size() bytes");
+    for (int i = 0; i < N; i++) env(i);
+    memset(obs, 0, N * size);
+    team.run(N, [&](int i) { envs[i] -> init_packed(obs + i * size, size); });
+}
+
+void GymSolverBatch::step_packed(int* actions, int a, unsigned char* obs, int n) {
+    int N = envs.size(), size = packed_size();
+    check_size(a, N, "step needs one action for each environment");
+    check_size(n, N * size, "the states need GymSolverBatch.size() * packed_size() bytes");
+    for (int i = 0; i < N; i++) env(i);
+    memset(obs, 0, N * size);
+    team.run(N, [&](int i) {
+        if (envs[i] -> get_done()) return;
+        envs[i] -> set_decision(actions[i]);
+        envs[i] -> step_packed(obs + i * size, size);
+    });
+}
+
+int GymSolverBatch::simulate_packed(unsigned char* obs, int n, float* pi, int m, float* v, int t, int* info, int l) {
+    int N = envs.size(), size = packed_size(), na = nact();
+    check_size(n, N * size, "the states need GymSolverBatch.size() * packed_size() bytes");
+    check_size(m, N * na, "pi needs nact() floats for each environment");
+    check_size(t, N, "v needs one float for each environment");
+    check_size(l, N, "info needs one int for each environment");
+    for (int i = 0; i < N; i++) env(i);
+    memset(obs, 0, N * size);
+    team.run(N, [&](int i) {
+        info[i] = envs[i] -> get_done() ? 0 : envs[i] -> simulate_packed(obs + i * size, size, pi + i * na, na, v + i, 1);
+    });
+    int more = 0;
+    for (int i = 0; i < N; i++) more += info[i] != 0;
+    return more;
+}
@@ -2,15 +2,133 @@
 #define Minisat_GymSolver_h
 
 #include "minisat/simp/SimpSolver.h"
+#include "minisat/gym/corpus.h"
+#include "minisat/gym/problem_cache.h"
+#include "minisat/gym/records.h"
+#include "minisat/gym/thread_team.h"
 
 namespace Minisat {
 
+// a cache of the evaluations of the network (see minisat/core/eval_cache.h), to be shared by the GymSolvers of one network:
+// a new MCTS leaf whose state is in the cache is not returned by simulate(), its cached pi and v are backed up at once
+class EvalCache {
+	eval_cache C;
+	friend class GymSolver;
+
+public:
+	EvalCache(int capacity);                     // at most capacity states (the least recently used are dropped first)
+	int       size();
+	int       capacity();
+	long long hits();                            // the number of new leaves that were found in the cache
+	long long misses();                          // the number of new leaves that were not
+	void      clear();                           // drop all states (the network has changed)
+};
+
+// the problems that GymSolvers have read and simplified (see minisat/gym/problem_cache.h), to be shared by the GymSolvers of one process:
+// a GymSolver of a problem in the cache copies its simplified solver instead of reading and simplifying the file again
+class ProblemCache {
+	problem_cache C;
+	friend class GymSolver;
+
+public:
+	ProblemCache(int capacity);                  // at most capacity problems (the least recently used are dropped first)
+	int       size();
+	int       capacity();
+	long long hits();                            // the number of GymSolvers that copied a cached problem
+	long long misses();                          // the number of GymSolvers that read their file (a new or changed one)
+	void      clear();
+};
+
+// a corpus: the problems of a directory compiled into one file (see minisat/gym/corpus.h, and minisat_corpus to compile one),
+// mapped into memory. A GymSolver of a problem of the corpus is built from its literals, without opening a file
+class Corpus {
+	corpus_reader R;
+	friend class GymSolver;
+
+public:
+	Corpus(char* path);                          // ValueError if the file is not a corpus
+	int         size();                          // the number of problems
+	bool        simplified();                    // whether the problems are simplified already (see minisat_corpus -simp)
+	const char* name(int problem);               // the file name of the problem (IndexError if it is out of range)
+	int         vars(int problem);               // the variables of the problem
+	int         clauses(int problem);            // the clauses of the problem
+	int         find(char* name);                // the problem of the file name (-1 if there is none)
+};
+
+// the policy and value network, evaluated in the library (see minisat/core/nn_model.h for the file of the exported weights):
+// with a model, simulate_native(4) evaluates the leaves itself, without a call back to python for each batch
+class NNModel {
+	nn_model M;
+	friend class GymSolver;
+	friend class GymSolverBatch;
+
+public:
+	NNModel(char* path);                         // load the weights of the file (ValueError if the file is not a valid model)
+	int    input_size();                         // the floats of a state (max_clause * max_var * 2 of the GymSolvers it fits)
+	int    nact();                               // the number of actions (max_var * 2)
+	void   evaluate(float* array, int n, float* pi, int m, float* v, int t); // the pi (nact() each) and v of the n / input_size() states
+};
+
+// the training records of self-play in a file (see minisat/gym/records.h for the format): RecordWriter appends the records of the
+// moves of an episode, and the writers of many environments (and processes) may append to one file at once
+class RecordWriter {
+	record_writer W;
+
+public:
+	RecordWriter(char* path, int max_clause, int max_var); // open or create the file (ValueError if it holds records of other dims)
+	void      add(unsigned char* obs, int n, float* pi, int m, float value, int instance, int step); // one record (kept until flush):
+	                                             // the packed state (packed_size() bytes), pi (nact() floats) and the value of the move
+	void      flush();                           // append the records added since the last flush, all in a row
+	void      close();                           // flush, and close the file
+	int       pending();                         // the records added and not flushed yet
+	long long written();                         // the records flushed by this writer
+	int       packed_size();
+	int       nact();
+};
+
+// RecordReader maps the records of a file into memory, so that batches are drawn from it without loading the file
+class RecordReader {
+	record_reader R;
+
+public:
+	RecordReader(char* path);                    // ValueError if the file is not a file of records
+	long long size();                            // the number of records
+	long long refresh();                         // map the records appended since, and return the new size()
+	int       max_clause();
+	int       max_var();
+	int       packed_size();
+	int       nact();
+	// copy the records of the k indices (IndexError if one is out of range) to obs (k * packed_size() bytes), pi (k * nact() floats),
+	// v (k floats) and info (k pairs of the instance and the step)
+	void      gather(long long* index, int k, unsigned char* obs, int n, float* pi, int m, float* v, int t, int* info, int l);
+	// the same for t records drawn uniformly (with replacement) by the seed
+	void      sample(long long seed, unsigned char* obs, int n, float* pi, int m, float* v, int t, int* info, int l);
+};
+
 class GymSolver {
 	
 	SimpSolver S;
+	bool   building;                  // true for a problem made in memory, whose clauses are added until init()
+	void   set_dims(int max_clause, int max_var, int mcts_size);
+	void   load(char* sat_prob, ProblemCache* cache);
+	void   load(Corpus* corpus, int problem);
+	void   finish_problem();          // simplify a problem made in memory (at its init)
 
 public:
 	GymSolver(char*);                 // set up the basics for char*, which is the filename of the SAT problem
+	GymSolver(char*, int max_clause, int max_var, int mcts_size); // the same, with the size of the states and of MCTS of this instance
+	                                  // (the defaults are in Hyper_Const, and the problem must have at most max_var variables). ValueError
+	                                  // if the file can not be read, or the problem is UNSAT by simplification.
+	GymSolver(char*, int max_clause, int max_var, int mcts_size, ProblemCache* cache); // the same, with the problem taken from the cache
+	                                  // (or read, simplified and added to it). The cache may be NULL, and must outlive the constructor only.
+	GymSolver(Corpus*, int problem, int max_clause, int max_var, int mcts_size); // the same, with the problem of the corpus
+	                                  // (IndexError if it is out of range). The corpus must outlive the constructor only.
+	GymSolver(int max_clause, int max_var, int mcts_size); // an empty problem made in memory, of the variables 1 .. max_var (see add_clauses)
+	GymSolver(int* clauses, int c, int max_clause, int max_var, int mcts_size); // the same, with the clauses of the array (as add_clauses)
+	void   add_clauses(int* clauses, int c); // add the clauses of an int32 array in DIMACS: v or -v for variable v (1 .. max_var), each
+	                                  // clause ended by 0 (ValueError if a literal is out of range, or the last clause is not ended).
+	                                  // Only to a problem made in memory, before init(), which simplifies it as a file is simplified
+	                                  // (ValueError if it is UNSAT by simplification).
 	bool   init(float* array, int n); // initialize the SAT problem and return the state. 
 									  // If return false, the Solver is in finished state and array is empty
 									  // one should call the constructor and the init() to reset on a SAT problem.
@@ -25,18 +143,111 @@ public:
 	// if return = 3, or (11 in binary): more simulation needed (dismeet the size constraint), the leaf_shadow state still needs to be evaluated
 	// one should call simulate until the result is 0, to build a complete MCTS. 
 	int    simulate(float* array, int n, float* pi, int m, float* v, int t); 
-	void   get_visit_count(float* array, int n); // get the nn vector from the root of MCTS (for PI)
+
+	// the batched simulate: array is space for a batch of states (k = n / state_size() of them), to write the states of up to k new leaves
+	// argument pi and v are for the states of the last call (get_waiting() of them, in order: one row of pi and one v for each state)
+	// return = 2 * (the number of new leaves) + 1 if more simulation is needed (dismeet the size constraint)
+	// one should call simulate_batch until the result is 0. Leaves in one batch are kept apart by virtual loss (see minisat/core/mcts.h)
+	int    simulate_batch(float* array, int n, float* pi, int m, float* v, int t);
+	int    get_waiting();                        // the number of states whose pi and v the next simulate call expects
+	int    simulate_native(int prior, int k);    // the whole MCTS of this move, with the pi of a heuristic instead of the network (and v = 0):
+	                                             // prior 0 is uniform, 1 the VSIDS activity, 2 Jeroslow-Wang, 3 the literal count in the state,
+	                                             // or with the pi and v of the model (prior 4, see use_model).
+	                                             // k leaves per batch. Returns the number of simulations. Not in a move that called simulate(),
+	                                             // and simulate() is not called after it in its move (ValueError for either).
+	void   get_visit_count(float* array, int n); // get the nn vector from the root of MCTS (for PI), of max_var * 2 actions
+	int    get_proven_action();                  // the first action of the shortest line to a finished state, once the search has proven it
+	                                             // (see mcts.h: the search stops there), or -1. The replay backend only proves one step lines.
+	void   use_replay(bool replay);              // choose the MCTS backend: true for replay (simulations run on the solver and undone), 
+	                                             // false for shadow copies (the default). Call before the first simulate().
+	                                             // Replay only proves a finished child of the root: below it, finished childern are
+	                                             // picked again (each such simulation is counted, with nothing to evaluate).
+	void   use_threads(int threads);             // the number of threads that collect the leaves of one simulate_batch() together (shadow backend only,
+	                                             // the default is 1). Leaves are the same for any number of threads only with one thread.
+	void   use_trees(int trees);                 // the number of independent trees that are searched at once, one thread each (shadow backend only,
+	                                             // the default is 1). get_visit_count() is the sum over the trees. Call before the first simulate().
+	void   use_transpositions(bool transpose);   // true (the default) to give a new leaf the evaluation of an evaluated one in the same state
+	                                             // (reached by another order of actions), instead of returning its state (shadow backend only)
+	void   use_cache(EvalCache* cache);          // the cache of evaluations to read and fill (NULL for none, the default). The cache must
+	                                             // outlive this GymSolver (or be replaced before it is destructed).
+	void   use_model(NNModel* model);            // the network of simulate_native(4) (NULL for none, the default). The same as for use_cache.
+	void   set_budget(double ms, long long propagations, long long bytes); // the budgets of the MCTS of each move (negative for none, the
+	                                             // default): wall time in milliseconds, propagations of the simulations, and bytes held by the
+	                                             // trees. simulate() reports no more simulation at the first one reached (or at mcts_size).
+	                                             // Call before init(): the budgets of a move start when its state is written.
+	int    get_simulations();                    // the simulations of the MCTS of this move so far (summed over the trees)
+	static void seed(long long seed);            // reseed the dirichlet noise of the MCTS roots. The generator is shared by the GymSolvers of
+	                                             // the process, so an episode played from the same seed takes the same moves only if no
+	                                             // other environment draws noise meanwhile (and with one thread and one tree).
 
 	void   set_decision(int decision);           // set the decision for the next step() call
 	void   step(float* array, int n);            // the step call (real step, not simulation)
 												 // one should call the set_decision() and step() to make a real step
 	void   step_forward(int decision);           // this overload step function calls set_decision from within. No state can be returned from here.
 	
+	// the same calls, writing the packed state instead (see minisat/core/state.h): packed_size() bytes, zeroed by the caller.
+	// Bit i of the bytes of column c (numpy.unpackbits with bitorder='little') is entry i of clause c in the float state,
+	// and one more column after the last clause holds the valid actions (the literals in the state).
+	int    state_size();                            // the number of floats of a state (max_clause * max_var * 2)
+	int    packed_size();
+	bool   init_packed(unsigned char* obs, int n);
+	int    simulate_packed(unsigned char* obs, int n, float* pi, int m, float* v, int t);
+	int    simulate_batch_packed(unsigned char* obs, int n, float* pi, int m, float* v, int t);
+	void   step_packed(unsigned char* obs, int n);
+
 	double get_reward();                          // get the reward (most likely -1 for all intermediate steps)
 	bool   get_done();                            // get if the state is done
 	char*  get_state();                           // get the pointer where state can be write to (NO LONGER FUNCTIONAL)
 };
 
+// N environments (GymSolvers) stepped and searched together: each call takes (N, ...) arrays, row i for environment i, and runs
+// the N environments on a team of threads, without the GIL. Environments that are done are skipped (their rows are left zero).
+class GymSolverBatch {
+	std::vector<GymSolver*> envs;
+	thread_team team;
+	int        dim0, dim1, size_lim;
+	bool       replay;                           // the settings of the environments, given to each problem loaded
+	EvalCache* cache;
+	NNModel*   model;
+	ProblemCache* problems;
+	double     budget_ms;
+	long long  budget_props, budget_bytes;
+	GymSolver& env(int i);
+	void       place(int i, GymSolver* g);       // give g the settings, and make it environment i
+
+public:
+	GymSolverBatch(int n, int max_clause, int max_var, int mcts_size);
+	~GymSolverBatch();
+	int    size();                               // N
+	int    state_size();                         // the sizes of one row (see GymSolver)
+	int    packed_size();
+	int    nact();
+	void   load(int i, char* sat_prob);          // (re)start environment i on the problem of the file (call init() after loading all)
+	void   load(int i, Corpus* corpus, int problem); // the same, on the problem of the corpus
+	void   load(int i, int* clauses, int c);    // the same, on the problem of the clauses (see GymSolver::add_clauses)
+	void   use_threads(int threads);             // the threads that run the environments (the default is 1)
+	void   use_replay(bool replay);              // the same as for GymSolver, for all environments (loaded so far and later)
+	void   use_cache(EvalCache* cache);
+	void   use_model(NNModel* model);
+	void   use_problems(ProblemCache* problems); // the cache of the problems loaded from now on (NULL for none, the default)
+	void   set_budget(double ms, long long propagations, long long bytes);
+
+	void   init(float* array, int n);            // the states of all environments (N * state_size() floats)
+	void   step(int* actions, int a, float* array, int n); // take action i in environment i (a negative action for the default
+	                                             // decision of the solver), and return the new states
+	// simulate in each environment (see GymSolver::simulate): pi and v are for the states of the last call, and info gets the return
+	// code of each environment. Returns the number of environments that need more calls (one should call until it is 0)
+	int    simulate(float* array, int n, float* pi, int m, float* v, int t, int* info, int l);
+	void   simulate_native(int prior, int k);    // the whole MCTS of this move of each environment (see GymSolver::simulate_native)
+	void   get_visit_count(float* array, int n); // N * nact() floats
+	void   get_reward(float* array, int n);      // N floats
+	void   get_done(int* info, int l);           // N ints, 1 for the environments that are done
+
+	void   init_packed(unsigned char* obs, int n);                   // the same calls, with packed states (N * packed_size() bytes)
+	void   step_packed(int* actions, int a, unsigned char* obs, int n);
+	int    simulate_packed(unsigned char* obs, int n, float* pi, int m, float* v, int t, int* info, int l);
+};
+
 }
 
 #endif
\ No newline at end of file
@@ -1,5 +1,5 @@
 /* File : example.i */
-%module GymSolver
+%module(threads="1") GymSolver
 
 %{
 	#define SWIG_FILE_WITH_INIT
@@ -41,11 +41,49 @@
       {(float* array, int n), (float* pi, int m)}
 %apply (float* INPLACE_ARRAY1, int DIM1)
       {(float* array, int n), (float* pi, int m), (float* v, int t)}
+%apply (unsigned char* INPLACE_ARRAY1, int DIM1)
+      {(unsigned char* obs, int n)}
+%apply (long long* INPLACE_ARRAY1, int DIM1)
+      {(long long* index, int k)}
+%apply (int* INPLACE_ARRAY1, int DIM1)
+      {(int* info, int l)}
+%apply (int* IN_ARRAY1, int DIM1)
+      {(int* actions, int a), (int* clauses, int c)}
 %apply (int DIM1  , float* INPLACE_ARRAY1)
       {(int length, float* data          )};
 %apply (float** ARGOUTVIEW_ARRAY1, int* DIM1  )
       {(float** data             , int* length)};
 
+// The calls that parse, simplify, propagate or search run without the GIL, so that the threads of python (e.g. a pool of environments,
+// one GymSolver each) run meanwhile. One GymSolver must still not be called by two threads at once. The short calls hold the GIL.
+%nothread;
+%thread GymSolver::GymSolver;
+%thread GymSolver::add_clauses;
+%thread GymSolver::init;
+%thread GymSolver::simulate;
+%thread GymSolver::simulate_batch;
+%thread GymSolver::simulate_native;
+%thread GymSolver::step;
+%thread GymSolver::step_forward;
+%thread GymSolver::init_packed;
+%thread GymSolver::simulate_packed;
+%thread GymSolver::simulate_batch_packed;
+%thread GymSolver::step_packed;
+%thread NNModel::NNModel;
+%thread NNModel::evaluate;
+%thread RecordWriter::flush;
+%thread RecordReader::gather;
+%thread RecordReader::sample;
+%thread GymSolverBatch::load;
+%thread GymSolverBatch::init;
+%thread GymSolverBatch::step;
+%thread GymSolverBatch::simulate;
+%thread GymSolverBatch::simulate_native;
+%thread GymSolverBatch::get_visit_count;
+%thread GymSolverBatch::init_packed;
+%thread GymSolverBatch::step_packed;
+%thread GymSolverBatch::simulate_packed;
+
 /* Let's just grab the original header file here */
 %include "GymSolver.h"
 
@@ -5,7 +5,57 @@ from os.path import isfile, join
 import gym
 import numpy as np
 
-from .GymSolver import GymSolver
+from .GymSolver import GymSolver, Corpus, EvalCache, NNModel, ProblemCache, RecordWriter, RecordReader
+
+
+def export_model(path, max_clause, max_var, trunk, policy, value):
+    """
+    This function writes the weights of a policy and value network to a file that NNModel (the network in the solver) loads
+    :param trunk, policy, value: lists of layers: ('conv', W, b, relu) with W of shape (kh, kw, cin, cout), 'same' padding,
+                                 or ('dense', W, b, relu) with W of shape (in, out) on the flattened (rows, columns, channels) input.
+                                 The input of the trunk is the state (max_clause, max_var, 2), and both heads start from its output:
+                                 the policy head gives the max_var * 2 logits (pi is their softmax), the value head one number (v is its tanh)
+    """
+    words = [int.from_bytes(b"MNN1", "little"), max_clause, max_var, 2, len(trunk), len(policy), len(value)]
+    with open(path, "wb") as f:
+        f.write(np.asarray(words, dtype="<u4").tobytes())
+        for kind, w, b, relu in list(trunk) + list(policy) + list(value):
+            w = np.asarray(w, dtype="<f4")
+            if kind == "conv":
+                assert w.ndim == 4, "the weights of a conv layer are (kh, kw, cin, cout)"
+                head = [1] + list(w.shape) + [int(relu)]
+            else:
+                assert kind == "dense" and w.ndim == 2, "a layer is ('conv', W, b, relu) or ('dense', W, b, relu)"
+                head = [2] + list(w.shape) + [int(relu)]
+            f.write(np.asarray(head, dtype="<u4").tobytes())
+            f.write(w.tobytes())
+            f.write(np.asarray(b, dtype="<f4").reshape(-1).tobytes())
+
+
+def sample_records(reader, batch, seed):
+    """
+    This function draws a batch of training records uniformly from a RecordReader (a file of records, see minisat/gym/records.h)
+    :return: the packed states (batch, packed_size) as uint8, pi (batch, nact), the values (batch,), and the instances and steps (batch,)
+    """
+    obs = np.zeros((batch, reader.packed_size()), dtype=np.uint8)
+    pi = np.zeros((batch, reader.nact()), dtype=np.float32)
+    v = np.zeros(batch, dtype=np.float32)
+    info = np.zeros((batch, 2), dtype=np.int32)
+    reader.sample(seed, obs.reshape(-1), pi.reshape(-1), v, info.reshape(-1))
+    return obs, pi, v, info[:, 0], info[:, 1]
+
+
+# the ProblemCaches of this process, by their capacity: the environments of one process share their parsed and simplified problems
+_problem_caches = {}
+
+
+def shared_problem_cache(capacity):
+    """
+    This function gets the ProblemCache of this process of the capacity (made at the first call), for GymSolvers of any dims
+    """
+    if capacity not in _problem_caches:
+        _problem_caches[capacity] = ProblemCache(capacity)
+    return _problem_caches[capacity]
 
 
 class gym_sat_Env(gym.Env):
@@ -18,20 +68,62 @@ class gym_sat_Env(gym.Env):
             sat_dir,
             max_clause=100,
             max_var=20,
-            mode='random'
+            mode='random',
+            mcts='shadow',
+            obs='float',
+            mcts_size=100,
+            mcts_threads=1,
+            mcts_trees=1,
+            mcts_transpose=True,
+            eval_cache=0,
+            problem_cache=64,
+            mcts_ms=-1,
+            mcts_props=-1,
+            mcts_bytes=-1,
+            model=None
     ):
         """
-        :param sat_dir: directory to the sat problems
-        :param max_clause: number of rows for the final state
-        :param max_var: number of columns for the final state
+        :param sat_dir: directory to the sat problems, or a corpus file of them (compiled by minisat_corpus, see
+                        minisat/gym/corpus.h): its problems are mapped into memory, and no file is opened at reset
+        :param max_clause: number of rows for the final state (clauses beyond it are cut off)
+        :param max_var: number of columns for the final state (at most 128, and at least the variables of every problem)
         :param mode: 'random' => at reset, randomly pick a file from directory
                      'iterate' => at reset, iterate each file one by one
                      'repeat^n' => at reset, give the same problem n times before iterates to the next one
                      'filename' => at reset, repeatedly use the given filename
+        :param mcts: 'shadow' => MCTS nodes keep a copy of the solver state (difference to the parent)
+                     'replay' => MCTS nodes keep statistics only, simulations run on the solver and are undone
+                                 (only a finished child of the root is proven: below it, a simulation may step into a finished state
+                                 again, see get_proven_action)
+        :param obs: 'float' => states are float32 arrays of shape (max_clause, max_var, 2)
+                    'packed' => states are uint8 arrays of GymSolver.packed_size() bytes: the same 0/1 values as bits,
+                                followed by the valid actions (see unpack_state)
+        :param mcts_size: number of MCTS simulations per step
+        :param mcts_threads: number of threads that collect the leaves of one simulate_batch call together (mcts='shadow' only)
+        :param mcts_trees: number of independent MCTS trees searched at once, one thread each (mcts='shadow' only),
+                           get_visit_count sums their visit counts
+        :param mcts_transpose: a new MCTS leaf in the same state as an evaluated one (reached by another order of actions)
+                               takes its evaluation, instead of being returned by simulate (mcts='shadow' only)
+        :param eval_cache: number of states whose evaluation (pi, v) is kept across moves and problems (0 for no cache):
+                           a new MCTS leaf in one of them is backed up at once, instead of being returned by simulate
+        :param problem_cache: number of problems kept parsed and simplified by this process (0 for none), shared by its environments:
+                              reset copies the solver of a cached problem instead of reading and simplifying its file again
+                              (not used with a corpus)
+        :param mcts_ms: wall time of the MCTS of a step, in milliseconds (negative for no limit)
+        :param mcts_props: propagations of the MCTS simulations of a step (negative for no limit)
+        :param mcts_bytes: bytes held by the MCTS trees (negative for no limit)
+                           the MCTS of a step stops at whichever of these, or of mcts_size, is reached first (see get_simulations)
+        :param model: file of the weights of the network (see export_model), for simulate_native(prior='model'), or None
         """
         print("SAT-v0: at dir {} max_clause {} max_var {} mode {}".format(sat_dir, max_clause, max_var, mode))
         self.sat_dir = sat_dir
-        self.sat_files = [join(self.sat_dir, f) for f in listdir(self.sat_dir) if isfile(join(self.sat_dir, f))]
+        if isfile(sat_dir):
+            # the "files" are the indices of the problems of the corpus
+            self.corpus = Corpus(sat_dir)
+            self.sat_files = list(range(self.corpus.size()))
+        else:
+            self.corpus = None
+            self.sat_files = [join(self.sat_dir, f) for f in listdir(self.sat_dir) if isfile(join(self.sat_dir, f))]
         self.sat_file_num = len(self.sat_files)
 
         self.max_clause = max_clause
@@ -39,19 +131,80 @@ class gym_sat_Env(gym.Env):
         self.observation_space = np.zeros((max_clause, max_var, 2), dtype=bool)
         self.action_space = max_var * 2
         self.mode = mode
+        assert mcts in ("shadow", "replay"), "mcts {} is not one of shadow, replay".format(mcts)
+        self.mcts = mcts
+        assert obs in ("float", "packed"), "obs {} is not one of float, packed".format(obs)
+        self.packed = obs == "packed"
+        self.mcts_size = mcts_size
+        assert mcts_threads >= 1, "mcts_threads {} is less than 1".format(mcts_threads)
+        self.mcts_threads = mcts_threads
+        assert mcts_trees >= 1, "mcts_trees {} is less than 1".format(mcts_trees)
+        self.mcts_trees = mcts_trees
+        self.mcts_transpose = mcts_transpose
+        assert eval_cache >= 0, "eval_cache {} is less than 0".format(eval_cache)
+        self.eval_cache = EvalCache(eval_cache) if eval_cache > 0 else None
+        assert problem_cache >= 0, "problem_cache {} is less than 0".format(problem_cache)
+        self.problem_cache = shared_problem_cache(problem_cache) if problem_cache > 0 else None
+        self.mcts_budget = (mcts_ms, mcts_props, mcts_bytes)
+        self.model = NNModel(model) if model is not None else None
         if mode.startswith("repeat^"):
             self.repeat_limit = int(mode.split('^')[1])
         elif mode == "random" or mode == "iterate":
             pass
         else:
             try:
-                self.file_index = self.sat_files.index(join(self.sat_dir, self.mode))
+                if self.corpus is not None:
+                    self.file_index = self.corpus.find(self.mode)
+                    assert self.file_index >= 0, "file {} in not in corpus {}".format(mode, sat_dir)
+                else:
+                    self.file_index = self.sat_files.index(join(self.sat_dir, self.mode))
             except ValueError:
                 assert False, "file {} in not in dir {}".format(mode, sat_dir)
         # this class is stateful, by these fields
         self.repeat_counter = 0
         self.iterate_counter = 0
 
+    def new_state(self, batch=()):
+        """
+        This function allocates the (zeroed) memory for one state, in the format of obs (or for a batch of states, given batch=(n,))
+        """
+        if self.packed:
+            return np.zeros(batch + (self.S.packed_size(),), dtype=np.uint8)
+        return np.zeros(batch + (self.max_clause, self.max_var, 2), dtype=np.float32)
+
+    def init_solver(self, pick_file):
+        """
+        This function loads the problem of pick_file (a path, the index of a problem of the corpus, or an int32 array of clauses: see
+        reset_with) into self.S, and writes its first state
+        :returns: the first state, and false if the problem is finished by simplification
+        """
+        if isinstance(pick_file, np.ndarray):
+            self.S = GymSolver(pick_file, self.max_clause, self.max_var, self.mcts_size)
+        elif self.corpus is not None:
+            self.S = GymSolver(self.corpus, pick_file, self.max_clause, self.max_var, self.mcts_size)
+        else:
+            self.S = GymSolver(pick_file, self.max_clause, self.max_var, self.mcts_size, self.problem_cache)
+        self.S.use_replay(self.mcts == "replay")
+        self.S.use_threads(self.mcts_threads)
+        self.S.use_trees(self.mcts_trees)
+        self.S.use_transpositions(self.mcts_transpose)
+        self.S.use_cache(self.eval_cache)
+        self.S.set_budget(*self.mcts_budget)
+        self.S.use_model(self.model)
+        state = self.new_state()
+        if self.packed:
+            return state, self.S.init_packed(state)
+        return state, self.S.init(np.reshape(state, (self.max_clause * self.max_var * 2,)))
+
+    def unpack_state(self, packed):
+        """
+        This function unpacks a packed state (obs='packed'), as the model side would do on its own device
+        :returns: the float32 state of shape (clauses, max_var, 2), and the bool mask of the valid actions
+        """
+        col_bytes = (self.action_space + 7) // 8
+        bits = np.unpackbits(packed.reshape(-1, col_bytes), axis=1, bitorder='little')[:, :self.action_space]
+        return bits[:-1].reshape(-1, self.max_var, 2).astype(np.float32), bits[-1].astype(bool)
+
     def reset(self):
         """
         This function reset the minisat by the rule of mode
@@ -80,9 +233,7 @@ class gym_sat_Env(gym.Env):
         else:
             pick_file = self.sat_files[self.file_index]
             self.repeat_counter += 1
-        state = np.zeros((self.max_clause, self.max_var, 2), dtype=np.float32)
-        self.S = GymSolver(pick_file)
-        self.S.init(np.reshape(state, (self.max_clause * self.max_var * 2,)))
+        state, _ = self.init_solver(pick_file)
         return state
 
     # self.curr_state, self.clause_counter, self.isSolved, self.actionSet = self.parse_state()
@@ -95,9 +246,19 @@ class gym_sat_Env(gym.Env):
         assert (file_no >= 0) and (file_no < self.sat_file_num), "file_no has to be a valid file list index"
         pick_file = self.sat_files[file_no]
         #		print("{} --> {}".format(file_no, pick_file))
-        state = np.zeros((self.max_clause, self.max_var, 2), dtype=np.float32)
-        self.S = GymSolver(pick_file)
-        if self.S.init(np.reshape(state, (self.max_clause * self.max_var * 2,))):
+        state, live = self.init_solver(pick_file)
+        if live:
+            return state
+        else:
+            return None
+
+    def reset_with(self, clauses):
+        """
+        This function reset the minisat on a problem made in memory (e.g. by a generator), with no file: clauses are the literals of
+        its clauses in DIMACS (v or -v for variable v, 1 .. max_var, each clause ended by 0), as one int32 array
+        """
+        state, live = self.init_solver(np.ascontiguousarray(clauses, dtype=np.int32).ravel())
+        if live:
             return state
         else:
             return None
@@ -113,8 +274,11 @@ class gym_sat_Env(gym.Env):
 
         # It is safe to always assume that the state also needs to be returned
         self.S.set_decision(decision)
-        state = np.zeros((self.max_clause, self.max_var, 2), dtype=np.float32)
-        self.S.step(np.reshape(state, (self.max_clause * self.max_var * 2,)))
+        state = self.new_state()
+        if self.packed:
+            self.S.step_packed(state)
+        else:
+            self.S.step(np.reshape(state, (self.max_clause * self.max_var * 2,)))
         return self.S.get_done(), state
 
     def simulate(self, pi, v):
@@ -123,9 +287,12 @@ class gym_sat_Env(gym.Env):
         from neural net for the state from the last simulation
         :returns: state (next state to evaluate), bool (need evaluate state, not empty), bool (need more MCTS steps)
         """
-        state = np.zeros((self.max_clause, self.max_var, 2), dtype=np.float32)
-        code = self.S.simulate(np.reshape(state, (self.max_clause * self.max_var * 2,)), pi,
-                               np.asarray([v], dtype=np.float32))
+        state = self.new_state()
+        if self.packed:
+            code = self.S.simulate_packed(state, pi, np.asarray([v], dtype=np.float32))
+        else:
+            code = self.S.simulate(np.reshape(state, (self.max_clause * self.max_var * 2,)), pi,
+                                   np.asarray([v], dtype=np.float32))
         if code == 0:
             return state, False, False
         if code == 1:
@@ -136,10 +303,78 @@ class gym_sat_Env(gym.Env):
             return state, True, True
         assert False, "return code of simulation {} is not one of the designed value".format(code)
 
+    def simulate_batch(self, pi, v, batch):
+        """
+        This function makes up to batch simulation steps, while providing the pi and v from neural net for the
+        states returned by the last simulation (one row of pi and one v for each of them, in order)
+        :returns: states (the new states to evaluate, possibly none), bool (need more MCTS steps)
+        """
+        states = self.new_state((batch,))
+        pi = np.asarray(pi, dtype=np.float32).reshape(-1)
+        v = np.asarray(v, dtype=np.float32).reshape(-1)
+        if self.packed:
+            code = self.S.simulate_batch_packed(states.reshape(-1), pi, v)
+        else:
+            code = self.S.simulate_batch(states.reshape(-1), pi, v)
+        return states[:code >> 1], bool(code & 1)
+
+    def simulate_native(self, prior="jw", batch=1):
+        """
+        This function runs the whole MCTS of this step in the solver, with a heuristic prior instead of the neural net (and v = 0),
+        for baselines, warm starts, or the throughput of the search alone (call it instead of simulate, then get_visit_count),
+        or with the network of the model file, evaluated in the solver
+        :param prior: 'uniform', 'activity' (VSIDS), 'jw' (Jeroslow-Wang), 'count' (occurrences of the literal in the state),
+                      or 'model' (the network, see the model argument)
+        :param batch: number of leaves per batch (see simulate_batch, for mcts_threads or mcts_trees)
+        :returns: the number of simulations
+        """
+        priors = {"uniform": 0, "activity": 1, "jw": 2, "count": 3, "model": 4}
+        assert prior in priors, "prior {} is not one of {}".format(prior, ", ".join(priors))
+        return self.S.simulate_native(priors[prior], batch)
+
+    def cache_stats(self):
+        """
+        This function gets the counters of the cache of evaluations (eval_cache > 0), for example to see if it is worth its size
+        :returns: dict of hits, misses and size (the number of states in it), or None without a cache
+        """
+        if self.eval_cache is None:
+            return None
+        return {"hits": self.eval_cache.hits(), "misses": self.eval_cache.misses(), "size": self.eval_cache.size()}
+
+    def clear_cache(self):
+        """
+        This function drops the cached evaluations (call it when the network has been trained)
+        """
+        if self.eval_cache is not None:
+            self.eval_cache.clear()
+
+    def seed(self, seed=None):
+        """
+        This function reseeds the dirichlet noise of the MCTS roots (see GymSolver.seed: it is shared by the environments of the
+        process), for example before each episode of a test or a replayed game
+        """
+        if seed is not None:
+            GymSolver.seed(seed)
+        return [seed]
+
+    def get_simulations(self):
+        """
+        This function gets the number of MCTS simulations of this step (less than mcts_size if a budget stopped the search)
+        """
+        return self.S.get_simulations()
+
     def get_visit_count(self):
         """
-        This function gets the visit count of the root node of MCTS
+        This function gets the visit count of the root node of MCTS (summed over the trees, with mcts_trees > 1)
+        These stay the visits of the search also when it has proven the shortest line of the move (see get_proven_action)
         """
         count = np.zeros((self.action_space,), dtype=np.float32)
         self.S.get_visit_count(count)
         return count
+
+    def get_proven_action(self):
+        """
+        This function gets the first action of the shortest line to a finished state, once the MCTS of this step has proven it (the
+        search stops there), or -1: take it as the decision. With mcts='replay', only a line of one step is proven
+        """
+        return self.S.get_proven_action()
@@ -0,0 +1,158 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "minisat/core/Dimacs.h"
+#include "minisat/simp/SimpSolver.h"
+#include "minisat/gym/corpus.h"
+
+using namespace Minisat;
+
+//=================================================================================================
+// The writer:
+
+namespace {
+
+// the clauses given by parse_DIMACS, kept as they are (as the literals of a corpus): loading them gives the solver of the file
+struct clause_collector {
+    vec<int32_t>& lits;
+    int           n_vars, n_clauses;
+
+    explicit clause_collector(vec<int32_t>& lits) : lits(lits), n_vars(0), n_clauses(0) {}
+    int  nVars () const { return n_vars; }
+    Var  newVar() { return n_vars++; }
+    void addClause_(vec<Lit>& ps) {
+        for (int i = 0; i < ps.size(); i++) lits.push(sign(ps[i]) ? -(var(ps[i]) + 1) : var(ps[i]) + 1);
+        lits.push(0);
+        n_clauses++; }
+};
+
+// write all of the n bytes (a write of a regular file may write less than it was given)
+bool write_all(int fd, const void* data, size_t n) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (n > 0) {
+        ssize_t k = write(fd, bytes, n);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        bytes += k; n -= k;
+    }
+    return true;
+}
+
+}
+
+const char* corpus_writer::add(const char* path, const char* name) {
+    gzFile in = gzopen(path, "rb");
+    if (in == NULL) return "the file can not be opened";
+
+    corpus_entry e;
+    e.lits = lits.size();
+    e.name = names.size();
+    if (!simplify) {
+        clause_collector c(lits);
+        parse_DIMACS(in, c, true);
+        gzclose(in);
+        e.vars = c.n_vars; e.clauses = c.n_clauses;
+    } else {
+        // the problem as the GymSolver has it after eliminate(true): the clauses left (without the satisfied ones and the false
+        // literals) and the top-level assignment, as unit clauses first
+        SimpSolver S;
+        S.verbosity = 0;
+        parse_DIMACS(in, S, true);
+        gzclose(in);
+        if (!S.eliminate(true)) return "the problem is UNSAT by simplification";
+        e.vars = S.nVars(); e.clauses = 0;
+        for (TrailIterator t = S.trailBegin(); t != S.trailEnd(); ++t, e.clauses++) {
+            lits.push(sign(*t) ? -(var(*t) + 1) : var(*t) + 1);
+            lits.push(0);
+        }
+        for (ClauseIterator c = S.clausesBegin(); c != S.clausesEnd(); ++c) {
+            const Clause& cl = *c;
+            bool sat = false;
+            for (int i = 0; i < cl.size() && !sat; i++) sat = S.value(cl[i]) == l_True;
+            if (sat) continue;
+            for (int i = 0; i < cl.size(); i++)
+                if (S.value(cl[i]) != l_False) lits.push(sign(cl[i]) ? -(var(cl[i]) + 1) : var(cl[i]) + 1);
+            lits.push(0);
+            e.clauses++;
+        }
+    }
+    for (const char* s = name; *s; s++) names.push(*s);
+    names.push('\0');
+    index.push(e);
+    return NULL;
+}
+
+const char* corpus_writer::write(const char* path) const {
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return "the corpus file can not be created";
+    uint64_t n_lits = lits.size(), n_names = names.size();
+    uint32_t h[corpus_format::header_words] = { (uint32_t)corpus_format::magic, simplify ? (uint32_t)corpus_format::simplified : 0,
+                                                (uint32_t)index.size(), 0, (uint32_t)n_lits, (uint32_t)(n_lits >> 32),
+                                                (uint32_t)n_names, (uint32_t)(n_names >> 32) };
+    corpus_entry end = { n_lits, n_names, 0, 0 };
+    bool ok = write_all(fd, h, sizeof(h))
+           && (index.size() == 0 || write_all(fd, &index[0], index.size() * sizeof(corpus_entry)))
+           && write_all(fd, &end, sizeof(end))
+           && (n_lits  == 0 || write_all(fd, &lits[0], n_lits * sizeof(int32_t)))
+           && (n_names == 0 || write_all(fd, &names[0], n_names));
+    if (::close(fd) != 0) ok = false;
+    return ok ? NULL : "the corpus can not be written";
+}
+
+//=================================================================================================
+// The reader:
+
+const char* corpus_reader::open(const char* path) {
+    close();
+    fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return "the corpus file can not be opened";
+    struct stat st;
+    uint32_t h[corpus_format::header_words];
+    if (fstat(fd, &st) != 0 || pread(fd, h, sizeof(h), 0) != (ssize_t)sizeof(h) || h[0] != (uint32_t)corpus_format::magic) {
+        close();
+        return "the file is not a corpus";
+    }
+    uint64_t n = h[2], n_lits = h[4] | (uint64_t)h[5] << 32, n_names = h[6] | (uint64_t)h[7] << 32;
+    if (n > INT32_MAX || n_lits > ((uint64_t)st.st_size >> 2) || n_names > (uint64_t)st.st_size
+        || corpus_format::names_offset(n, n_lits) + (int64_t)n_names != (int64_t)st.st_size) {
+        close();
+        return "the corpus file is truncated or corrupt";
+    }
+
+    void* m = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) { close(); return "the corpus file can not be mapped"; }
+    base       = (const uint8_t*)m;
+    mapped     = st.st_size;
+    n_problems = n;
+    flags      = h[1];
+    index      = (const corpus_entry*)(base + corpus_format::index_offset());
+    lits       = (const int32_t*)(base + corpus_format::lits_offset(n));
+    names      = (const char*)(base + corpus_format::names_offset(n, n_lits));
+
+    // the index must be in order and within the file, and each problem must end with the end of a clause (the literals themselves
+    // are checked against the variables of their problem as they are loaded)
+    bool ok = index[n].lits == n_lits && index[n].name == n_names && (n_names == 0 || names[n_names - 1] == '\0');
+    for (uint64_t i = 0; ok && i < n; i++)
+        ok = index[i].lits <= index[i + 1].lits && index[i].name < index[i + 1].name
+          && (index[i].lits == index[i + 1].lits || lits[index[i + 1].lits - 1] == 0);
+    if (!ok) { close(); return "the corpus file is truncated or corrupt"; }
+    return NULL;
+}
+
+void corpus_reader::close() {
+    if (base != NULL) munmap((void*)base, mapped);
+    if (fd >= 0) ::close(fd);
+    fd = -1; base = NULL; mapped = 0; n_problems = 0; flags = 0; index = NULL; lits = NULL; names = NULL;
+}
+
+int corpus_reader::find(const char* name) const {
+    for (int i = 0; i < n_problems; i++)
+        if (strcmp(names + index[i].name, name) == 0) return i;
+    return -1;
+}
@@ -0,0 +1,87 @@
+#ifndef Minisat_corpus_h
+#define Minisat_corpus_h
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "minisat/mtl/Vec.h"
+
+namespace Minisat {
+
+// A corpus is a directory of problems compiled into one file (see minisat/simp/CorpusMain.cc), that the GymSolvers map into memory
+// and build their solvers from, instead of opening (and unzipping) a file at each reset.
+//
+// A file is a header of 8 32 bit little endian words: 'MCN1' (the magic), the flags (1 if the problems are simplified), the number of
+// problems n, 0, the number of literals (64 bits, low word first) and the bytes of the names (64 bits), then
+//   the index  -- n + 1 entries of 24 bytes: the offset of the first literal of the problem (64 bits), the offset of its name (64 bits),
+//                 its variables and its clauses (32 bits each). Problem i ends where problem i + 1 starts (entry n marks the end),
+//   the literals of all problems (32 bit ints, in DIMACS: v + 1 or -(v + 1) for variable v, each clause ended by 0),
+//   the names of the problems (their file names, each ended by '\0').
+// The literals of a problem are the clauses of its file as they are, or (for a simplified corpus) the clauses left by eliminate()
+// and the top-level assignment as unit clauses. The variables of the problem are those of its solver (the largest one of its file).
+struct corpus_entry {
+    uint64_t lits;
+    uint64_t name;
+    uint32_t vars;
+    uint32_t clauses;
+};
+
+struct corpus_format {
+    enum { magic = 'M' | 'C' << 8 | 'N' << 16 | '1' << 24, header_words = 8, simplified = 1 };
+    static int64_t index_offset() { return header_words * sizeof(uint32_t); }
+    static int64_t lits_offset (int64_t n) { return index_offset() + (n + 1) * sizeof(corpus_entry); }
+    static int64_t names_offset(int64_t n, int64_t lits) { return lits_offset(n) + lits * sizeof(int32_t); }
+};
+
+// corpus_writer -- reads the problems of files (optionally simplifying them), and writes them all to a corpus
+class corpus_writer {
+public:
+    explicit corpus_writer(bool simplify = false) : simplify(simplify) {}
+
+    const char* add  (const char* path, const char* name);  // read the problem of the file (NULL on success, else what is wrong)
+    const char* write(const char* path) const;              // write the corpus of the problems added (NULL on success)
+    int         size () const { return index.size(); }
+    int64_t     literals() const { return lits.size(); }
+
+private:
+    bool               simplify;
+    vec<int32_t>       lits;
+    vec<char>          names;
+    vec<corpus_entry>  index;                     // (without the last entry, that marks the end)
+};
+
+// corpus_reader -- the problems of a corpus, mapped into memory (read only). They may be read by several threads at once.
+class corpus_reader {
+public:
+    corpus_reader() : fd(-1), base(NULL), mapped(0), n_problems(0), flags(0), index(NULL), lits(NULL), names(NULL) {}
+    ~corpus_reader() { close(); }
+
+    const char*    open (const char* path);       // map the file (NULL on success, else what is wrong with it)
+    void           close();
+    bool           opened    () const { return base != NULL; }
+    int            size      () const { return n_problems; }
+    bool           simplified() const { return flags & corpus_format::simplified; }
+    int            find      (const char* name) const; // the problem of the name (-1 if there is none)
+
+    const char*    name    (int i) const { check(i); return names + index[i].name; }
+    int            vars    (int i) const { check(i); return index[i].vars; }
+    int            clauses (int i) const { check(i); return index[i].clauses; }
+    const int32_t* literals(int i) const { check(i); return lits + index[i].lits; }
+    int64_t        n_literals(int i) const { check(i); return index[i + 1].lits - index[i].lits; }
+
+private:
+    int                 fd;
+    const uint8_t*      base;
+    size_t              mapped;
+    int                 n_problems;
+    uint32_t            flags;
+    const corpus_entry* index;
+    const int32_t*      lits;
+    const char*         names;
+
+    void check(int i) const { assert(i >= 0 && i < n_problems); (void)i; }
+};
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef Minisat_problem_cache_h
+#define Minisat_problem_cache_h
+
+#include <assert.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "minisat/simp/SimpSolver.h"
+
+namespace Minisat {
+
+// problem_cache -- the problems that the GymSolvers of this process have parsed and simplified, by the path of their file
+//
+// A new GymSolver of a cached problem copies its simplified solver (see Solver::copyProblem) instead of reading and simplifying the file
+// again: in the repeat^n mode of MiniSATEnv, and whenever episodes come back to a problem. An entry is dropped when its file has changed
+// (by the time, in nanoseconds, and the size of its last modification). The version of a file is the one find() saw, before the file
+// was read, so that a file changed while it is read is not cached as the new version. The cache holds at most 'capacity' problems, and
+// drops the least recently used one to make room. The problems are shared (read only) with the GymSolvers that copy them, so one cache may be used by several threads.
+class problem_cache {
+public:
+    typedef std::shared_ptr<const SimpSolver> problem;
+    struct version {                                      // the last modification of a file (known is false if it can not be stat'ed)
+        bool     known;
+        timespec mtime;
+        off_t    bytes;
+        version() : known(false), mtime(), bytes(0) {}
+        bool operator==(const version& v) const {
+            return known && v.known && mtime.tv_sec == v.mtime.tv_sec && mtime.tv_nsec == v.mtime.tv_nsec && bytes == v.bytes; }
+    };
+
+    explicit problem_cache(int capacity) : cap(capacity), clock(0), n_hits(0), n_misses(0) { assert(capacity > 0); }
+
+    problem find  (const char* path, version& v);        // the cached problem of the file (NULL if there is none), and its version now
+    void    insert(const char* path, const version& v, const problem& p); // add the problem of the file of version v (read and simplified
+                                                          // just after find gave v)
+    void    clear ();
+
+    int      size    () const { std::lock_guard<std::mutex> guard(lock); return (int)problems.size(); }
+    int      capacity() const { return cap; }
+    uint64_t hits    () const { std::lock_guard<std::mutex> guard(lock); return n_hits; }
+    uint64_t misses  () const { std::lock_guard<std::mutex> guard(lock); return n_misses; }
+
+private:
+    struct entry { problem p; version v; uint64_t used; };
+
+    int        cap;
+    std::unordered_map<std::string, entry> problems;
+    uint64_t   clock;                                     // the number of finds and inserts (entry::used is the last one of its entry)
+    uint64_t   n_hits, n_misses;
+    mutable std::mutex lock;                              // guards all of the above
+
+    static version version_of(const char* path) {
+        version v;
+        struct stat st;
+        if (stat(path, &st) != 0) return v;
+        v.known = true; v.mtime = st.st_mtim; v.bytes = st.st_size;
+        return v; }
+};
+
+inline problem_cache::problem problem_cache::find(const char* path, version& v) {
+    v = version_of(path);
+    std::lock_guard<std::mutex> guard(lock);
+    std::unordered_map<std::string, entry>::iterator it = problems.find(path);
+    if (it != problems.end() && !(it -> second.v == v)) {
+        problems.erase(it);                               // (the file has changed since)
+        it = problems.end();
+    }
+    if (it == problems.end()) { n_misses++; return problem(); }
+    it -> second.used = ++clock;
+    n_hits++;
+    return it -> second.p;
+}
+
+inline void problem_cache::insert(const char* path, const version& v, const problem& p) {
+    if (!v.known) return;
+    entry e;
+    e.p = p; e.v = v;
+    std::lock_guard<std::mutex> guard(lock);
+    e.used = ++clock;
+    if (problems.count(path) == 0 && (int)problems.size() >= cap) {
+        std::unordered_map<std::string, entry>::iterator lru = problems.begin();
+        for (std::unordered_map<std::string, entry>::iterator it = problems.begin(); it != problems.end(); ++it)
+            if (it -> second.used < lru -> second.used) lru = it;
+        problems.erase(lru);
+    }
+    problems[path] = e;
+}
+
+inline void problem_cache::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    problems.clear();
+}
+
+}
+
+#endif
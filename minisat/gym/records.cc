@@ -0,0 +1,158 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "minisat/gym/records.h"
+
+using namespace Minisat;
+
+//=================================================================================================
+// The format:
+
+void record_format::header(uint32_t* words) const {
+    uint32_t h[header_words] = { (uint32_t)magic, (uint32_t)dims.dim0, (uint32_t)dims.dim1, (uint32_t)dims.nact(),
+                                 (uint32_t)dims.packed_size(), (uint32_t)record_size(), 0, 0 };
+    memcpy(words, h, sizeof(h));
+}
+
+bool record_format::read(const uint32_t* words) {
+    if (words[0] != (uint32_t)magic || (int)words[1] < 1 || (int)words[2] < 1 || (int)words[2] > Hyper_Const::max_nact / 2) return false;
+    dims = state_dims(words[1], words[2]);
+    return words[3] == (uint32_t)dims.nact() && words[4] == (uint32_t)dims.packed_size() && words[5] == (uint32_t)record_size();
+}
+
+// write all of the n bytes at the end of fd (a write of a regular file may write less than it was given)
+static bool write_all(int fd, const uint8_t* bytes, size_t n) {
+    while (n > 0) {
+        ssize_t k = write(fd, bytes, n);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        bytes += k; n -= k;
+    }
+    return true;
+}
+
+//=================================================================================================
+// The writer:
+
+const char* record_writer::open(const char* path, const state_dims& dims) {
+    close();
+    format = record_format(dims);
+    fd = ::open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) return "the record file can not be opened";
+
+    // the header: written by the first writer, checked by the others
+    const char* error = NULL;
+    struct stat st;
+    flock(fd, LOCK_EX);
+    if (fstat(fd, &st) != 0)
+        error = "the record file can not be opened";
+    else if (st.st_size == 0) {
+        uint32_t h[record_format::header_words];
+        format.header(h);
+        if (!write_all(fd, (const uint8_t*)h, sizeof(h)))
+            error = ftruncate(fd, 0) == 0 ? "the header of the record file can not be written"
+                                          : "the header of the record file can not be written, and a part of it is left in the file";
+    } else {
+        uint32_t h[record_format::header_words];
+        record_format file;
+        if (pread(fd, h, sizeof(h), 0) != (ssize_t)sizeof(h) || !file.read(h))
+            error = "the record file is not a file of records";
+        else if (file.dims.dim0 != dims.dim0 || file.dims.dim1 != dims.dim1)
+            error = "the records of the file are of other max_clause and max_var";
+    }
+    flock(fd, LOCK_UN);
+    if (error != NULL) { ::close(fd); fd = -1; }
+    return error;
+}
+
+void record_writer::add(const uint8_t* packed, const float* pi, float value, uint32_t instance, uint32_t step) {
+    std::lock_guard<std::mutex> guard(lock);
+    int size = format.record_size();
+    int at   = buffer.size();
+    buffer.growTo(at + size, 0);
+    uint8_t* r = &buffer[at];
+    memcpy(r, packed, format.dims.packed_size());
+    memcpy(r + format.pi_offset(), pi, format.dims.nact() * sizeof(float));
+    uint32_t tail[3];
+    memcpy(&tail[0], &value, sizeof(float));
+    tail[1] = instance;
+    tail[2] = step;
+    memcpy(r + format.value_offset(), tail, sizeof(tail));
+}
+
+const char* record_writer::flush() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (fd < 0) return "the record file is not open";
+    if (buffer.size() == 0) return NULL;
+
+    // O_APPEND puts the write at the end, and the lock keeps it from interleaving with a write of another writer,
+    // should the kernel take it in parts. A write that fails half way is cut off again, so that no part of a record
+    // is left in the file (the records after it would be read out of place).
+    struct stat st;
+    flock(fd, LOCK_EX);
+    const char* error = NULL;
+    if (fstat(fd, &st) != 0)
+        error = "the records can not be written";
+    else if (!write_all(fd, &buffer[0], buffer.size()))
+        error = ftruncate(fd, st.st_size) == 0 ? "the records can not be written"
+                                               : "the records can not be written, and a part of them is left in the file";
+    flock(fd, LOCK_UN);
+    if (error != NULL) return error;
+    n_records += buffer.size() / format.record_size();
+    buffer.clear();
+    return NULL;
+}
+
+void record_writer::close() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    buffer.clear();
+}
+
+//=================================================================================================
+// The reader:
+
+const char* record_reader::open(const char* path) {
+    close();
+    fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return "the record file can not be opened";
+    uint32_t h[record_format::header_words];
+    if (pread(fd, h, sizeof(h), 0) != (ssize_t)sizeof(h) || !format.read(h)) {
+        close();
+        return "the record file is not a file of records";
+    }
+    rsize = format.record_size();
+    const char* error = refresh();
+    if (error != NULL) close();
+    return error;
+}
+
+const char* record_reader::refresh() {
+    if (fd < 0) return "the record file is not open";
+    struct stat st;
+    if (fstat(fd, &st) != 0) return "the record file can not be read";
+    int64_t n = ((int64_t)st.st_size - record_format::record_offset(0, rsize)) / rsize;
+    size_t  bytes = record_format::record_offset(n, rsize);
+    if (base != NULL && bytes == mapped) return NULL;
+
+    void* m = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) return "the record file can not be mapped";
+    madvise(m, bytes, MADV_RANDOM);
+    if (base != NULL) munmap((void*)base, mapped);
+    base      = (const uint8_t*)m;
+    mapped    = bytes;
+    n_records = n;
+    return NULL;
+}
+
+void record_reader::close() {
+    if (base != NULL) munmap((void*)base, mapped);
+    if (fd >= 0) ::close(fd);
+    fd = -1; base = NULL; mapped = 0; n_records = 0;
+}
@@ -0,0 +1,96 @@
+#ifndef Minisat_records_h
+#define Minisat_records_h
+
+#include <stdint.h>
+#include <mutex>
+
+#include "minisat/mtl/Vec.h"
+#include "minisat/core/state.h"
+
+namespace Minisat {
+
+// The training records of self-play: one for each move of an episode, in files that are appended to by many environments at once
+// and read by the trainer through mmap, so that it samples records uniformly without loading a whole file.
+//
+// A file is a header of 8 32 bit little endian words: 'MTR1' (the magic), max_clause, max_var, nact, packed_size, record_size, 0, 0,
+// and then the records, all of record_size bytes:
+//   the packed state (packed_size bytes, see minisat/core/state.h), padded with zeros to a multiple of 4 bytes,
+//   pi    -- the target of the policy (nact floats, the normalized visit counts of the MCTS of the move),
+//   value -- the target of the value (a float, e.g. the return of the rest of the episode),
+//   the instance (the id of the problem, a uint32) and the step (the index of the move in its episode, a uint32).
+// As the records have one size, the index of the file is fixed: record i is at record_offset(i), and the file holds
+// (file size - the header) / record_size of them (a record that is still being written is not counted yet).
+struct record_format {
+    enum { magic = 'M' | 'T' << 8 | 'R' << 16 | '1' << 24, header_words = 8 };
+    state_dims dims;
+
+    record_format(const state_dims& dims = state_dims()) : dims(dims) {}
+    int  pi_offset    () const { return (dims.packed_size() + 3) & ~3; }
+    int  value_offset () const { return pi_offset() + dims.nact() * sizeof(float); }
+    int  record_size  () const { return value_offset() + sizeof(float) + 2 * sizeof(uint32_t); }
+    static int64_t record_offset(int64_t i, int record_size) { return header_words * sizeof(uint32_t) + i * record_size; }
+    void header(uint32_t* words) const;                // the header of a file of these records
+    bool read  (const uint32_t* words);                // the format of a header (false if it is not one)
+};
+
+// record_writer -- appends records to a file, shared with the writers of other environments (of this process or of others)
+//
+// The records added are kept until flush(), which appends them all with one write at the end of the file, under an exclusive flock:
+// the records of one flush are in a row, and those of the writers never interleave. The first writer of a new file writes its header;
+// the others check that their dims are those of the file. One writer may be used by several threads.
+class record_writer {
+public:
+    record_writer() : fd(-1), n_records(0) {}
+    ~record_writer() { close(); }
+
+    const char* open (const char* path, const state_dims& dims); // open (or create) the file (NULL on success, else what is wrong)
+    void        add  (const uint8_t* packed, const float* pi, float value, uint32_t instance, uint32_t step);
+    const char* flush();                                          // append the records added since the last flush (NULL on success)
+    void        close();                                          // (flush first: the records not flushed are dropped)
+    bool        opened () const { return fd >= 0; }
+    int         pending() const { std::lock_guard<std::mutex> guard(lock); return buffer.size() / format.record_size(); }
+    int64_t     written() const { std::lock_guard<std::mutex> guard(lock); return n_records; } // the records flushed by this writer
+    const record_format& get_format() const { return format; }
+
+private:
+    int             fd;
+    record_format   format;
+    vec<uint8_t>    buffer;
+    int64_t         n_records;
+    mutable std::mutex lock;                      // guards buffer and n_records
+};
+
+// record_reader -- the records of a file, mapped into memory (read only). refresh() maps the records appended since.
+// The records may be read by several threads at once (but not during refresh() or close()).
+class record_reader {
+public:
+    record_reader() : fd(-1), base(NULL), mapped(0), n_records(0), rsize(0) {}
+    ~record_reader() { close(); }
+
+    const char* open   (const char* path);        // map the file (NULL on success, else what is wrong with it)
+    const char* refresh();                        // map the file again, with the records written since
+    void        close  ();
+    bool        opened () const { return base != NULL; }
+    int64_t     size   () const { return n_records; }
+    const record_format& get_format() const { return format; }
+
+    const uint8_t* packed  (int64_t i) const { return record(i); }
+    const float*   pi      (int64_t i) const { return (const float*)(record(i) + format.pi_offset()); }
+    float          value   (int64_t i) const { return *(const float*)(record(i) + format.value_offset()); }
+    uint32_t       instance(int64_t i) const { return ((const uint32_t*)(record(i) + format.value_offset()))[1]; }
+    uint32_t       step    (int64_t i) const { return ((const uint32_t*)(record(i) + format.value_offset()))[2]; }
+
+private:
+    int            fd;
+    const uint8_t* base;
+    size_t         mapped;                        // the bytes mapped at base
+    int64_t        n_records;
+    int            rsize;
+    record_format  format;
+
+    const uint8_t* record(int64_t i) const { assert(i >= 0 && i < n_records); return base + record_format::record_offset(i, rsize); }
+};
+
+}
+
+#endif
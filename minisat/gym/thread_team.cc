@@ -0,0 +1,61 @@
+#include "minisat/gym/thread_team.h"
+
+using namespace Minisat;
+
+void thread_team::resize(int threads) {
+    if (threads < 1) threads = 1;
+    if (threads == size()) return;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    start.notify_all();
+    for (int t = 0; t < (int)workers.size(); t++) workers[t].join();
+    workers.clear();
+    stop = false;
+    for (int t = 1; t < threads; t++) workers.push_back(std::thread(&thread_team::worker, this, round));
+}
+
+void thread_team::work() {
+    for (int i; (i = next++) < n_jobs; )
+        try { job(i); }
+        catch (...) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!error) error = std::current_exception();
+        }
+}
+
+void thread_team::worker(unsigned seen) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            start.wait(guard, [&] { return stop || round != seen; });
+            if (stop) return;
+            seen = round;
+        }
+        work();
+        std::lock_guard<std::mutex> guard(lock);
+        if (--busy == 0) done.notify_one();
+    }
+}
+
+void thread_team::run(int n, const std::function<void(int)>& f) {
+    job    = f;
+    n_jobs = n;
+    next   = 0;
+    error  = nullptr;
+    if (workers.size() > 0 && n > 1) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            busy = workers.size();
+            round++;
+        }
+        start.notify_all();
+        work();
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [&] { return busy == 0; });
+    } else
+        work();
+    job = nullptr;
+    if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,46 @@
+#ifndef Minisat_thread_team_h
+#define Minisat_thread_team_h
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Minisat {
+
+// thread_team -- a fixed team of threads that run the jobs 0 .. n-1 of one call of run() together (see GymSolverBatch)
+//
+// The threads wait between calls, so a call costs a wake up instead of the start of threads (the calls of a batch of environments are
+// short and many). The caller is one of the team: with one thread, run() is a plain loop. A job that throws does not stop the others;
+// run() throws the first exception when all are done. run() must not be called by two threads at once.
+class thread_team {
+public:
+    explicit thread_team(int threads = 1) : n_jobs(0), next(0), busy(0), round(0), stop(false) { resize(threads); }
+    ~thread_team() { resize(1); }
+
+    void resize(int threads);                     // the number of threads, the caller included (at least 1)
+    int  size  () const { return (int)workers.size() + 1; }
+    void run   (int n, const std::function<void(int)>& job);
+
+private:
+    std::vector<std::thread>   workers;
+    std::function<void(int)>   job;
+    int                        n_jobs;
+    std::atomic<int>           next;              // the next job to take
+    int                        busy;              // the workers still in this round
+    unsigned                   round;             // the number of calls of run() so far (a worker waits for the next one)
+    bool                       stop;
+    std::exception_ptr         error;
+    std::mutex                 lock;              // guards busy, round, stop and error
+    std::condition_variable    start, done;
+
+    void work();                                  // take jobs until there are none left
+    void worker(unsigned seen);                   // (seen: the last round before the worker was started)
+};
+
+}
+
+#endif
@@ -21,6 +21,8 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef Minisat_Alloc_h
 #define Minisat_Alloc_h
 
+#include <string.h>
+
 #include "minisat/mtl/XAlloc.h"
 #include "minisat/mtl/Vec.h"
 
@@ -57,6 +59,9 @@ class RegionAllocator
     uint32_t wasted    () const      { return wasted_; }
 
     Ref      alloc     (int size); 
+    void     reserve   (uint64_t n)  { // room for n more elements, in one reallocation
+        if ((uint64_t)sz + n > UINT32_MAX) throw OutOfMemoryException();
+        capacity(sz + (uint32_t)n); }
     void     free      (int size)    { wasted_ += size; }
 
     // Deref, Load Effective Address (LEA), Inverse of LEA (AEL):
@@ -83,6 +88,13 @@ class RegionAllocator
         sz = cap = wasted_ = 0;
     }
 
+    void     copyTo(RegionAllocator& to) const {
+        to.capacity(sz);
+        if (sz > 0) memcpy(to.memory, memory, sz * sizeof(T));
+        to.sz = sz;
+        to.wasted_ = wasted_;
+    }
+
 
 };
 
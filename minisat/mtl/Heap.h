@@ -136,6 +136,10 @@ class Heap {
     }
 
 
+    // Copy the elements and their order (the comparator of 'to' stays its own):
+    void copyTo(Heap& to) const { heap.copyTo(to.heap); indices.copyTo(to.indices); }
+
+
     // Rebuild the heap from scratch, using the elements in 'ns':
     void build(const vec<K>& ns) {
         for (int i = 0; i < heap.size(); i++)
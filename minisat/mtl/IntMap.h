@@ -52,6 +52,10 @@ namespace Minisat {
         void     clear  (bool dispose = false) { map.clear(dispose); }
         void     moveTo (IntMap& to)           { map.moveTo(to.map); to.index = index; }
         void     copyTo (IntMap& to) const     { map.copyTo(to.map); to.index = index; }
+        void     deepCopyTo(IntMap& to) const  {          // (for values that are vecs themselves)
+            to.map.clear(); to.map.growTo(map.size());
+            for (int i = 0; i < map.size(); i++) map[i].copyVstructTo(to.map[i]);
+            to.index = index; }
     };
 
 
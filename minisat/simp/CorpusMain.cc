@@ -0,0 +1,74 @@
+/*************************************************************************************[CorpusMain.cc]
+Corpus compiler: the problems of a directory in one file, for the gym environment (see minisat/gym/corpus.h).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <dirent.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "minisat/utils/System.h"
+#include "minisat/utils/Options.h"
+#include "minisat/gym/corpus.h"
+
+using namespace Minisat;
+
+//=================================================================================================
+// The problems are in the order of their sorted file names (the names are kept, for MiniSATEnv's mode='filename'). A simplified
+// corpus holds the problems as eliminate() leaves them, so that the environments skip the simplification; the problems that are
+// UNSAT by simplification are left out of it.
+
+static BoolOption opt_simp("CORPUS", "simp", "Simplify the problems (variable elimination) before they are written.", false);
+static IntOption  opt_verb("CORPUS", "verb", "Verbosity level (0=silent, 1=some, 2=more).", 1, IntRange(0, 2));
+
+//=================================================================================================
+// Main:
+
+int main(int argc, char** argv)
+{
+    setUsageHelp("USAGE: %s [options] <cnf-directory> <corpus-file>\n\n  compiles the problems of the directory into the corpus.\n");
+    parseOptions(argc, argv, true);
+    if (argc != 3) printf("ERROR! Give a directory of problems and a corpus file (see --help)\n"), exit(1);
+
+    std::vector<std::string> files;
+    DIR* dir = opendir(argv[1]);
+    if (dir == NULL) printf("ERROR! Could not open directory: %s\n", argv[1]), exit(1);
+    for (struct dirent* e; (e = readdir(dir)) != NULL; )
+        if (e -> d_name[0] != '.') files.push_back(e -> d_name);
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+
+    double start = realTime();
+    corpus_writer corpus(opt_simp);
+    for (int i = 0; i < (int)files.size(); i++) {
+        std::string path = std::string(argv[1]) + "/" + files[i];
+        const char* error = corpus.add(path.c_str(), files[i].c_str());
+        if (error != NULL && opt_simp) {
+            if (opt_verb >= 1) printf("%s: %s (left out)\n", path.c_str(), error);
+        } else if (error != NULL)
+            printf("ERROR! %s: %s\n", path.c_str(), error), exit(1);
+        else if (opt_verb >= 2)
+            printf("%s\n", path.c_str());
+    }
+    const char* error = corpus.write(argv[2]);
+    if (error != NULL) printf("ERROR! %s: %s\n", argv[2], error), exit(1);
+    if (opt_verb >= 1)
+        printf("%d problems (%lld literals) in %.2f s\n", corpus.size(), (long long)corpus.literals(), realTime() - start);
+    return 0;
+}
@@ -164,6 +164,7 @@ int main(int argc, char** argv)
             printf("end of print\n");
             exit(0);
             */
+            ret = S.solveLimited(dummy); // initialize the problem (holds at the first decision, unless it is already solved)
             while (S.env_hold) { // Comments by Fei: SAT is not solved yet! it is on hold
                 S.agent_decision = S.default_pickLit(); // Comments by Fei: set up agent_decision (for now it is the same as pickBranchLit heuristics)
                 ret = S.step(); // this is doing one more step!
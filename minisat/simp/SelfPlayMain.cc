@@ -0,0 +1,176 @@
+/*************************************************************************************[SelfPlayMain.cc]
+Self-play runner: the episodes of the gym environment (MiniSATEnv) without python, for the training data.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "minisat/utils/System.h"
+#include "minisat/utils/Options.h"
+#include "minisat/gym/GymSolver.h"
+#include "minisat/gym/records.h"
+
+using namespace Minisat;
+
+//=================================================================================================
+// The shard is a file of training records (see minisat/gym/records.h), one for each move of the episodes: the packed state,
+// the normalized visit counts of the MCTS of the move, the return of the rest of the episode (-1 for each step but the last),
+// the index of the problem in the sorted directory, and the index of the move. The records of one episode are in a row.
+
+static IntOption    opt_threads ("SELFPLAY", "threads",    "Number of episodes run at once.", 1, IntRange(1, 1024));
+static IntOption    opt_episodes("SELFPLAY", "episodes",   "Number of episodes of each problem.", 1, IntRange(1, INT32_MAX));
+static IntOption    opt_clause  ("SELFPLAY", "max-clause", "Number of clauses of a state (the rest is cut off).", Hyper_Const::dim0, IntRange(1, INT32_MAX));
+static IntOption    opt_var     ("SELFPLAY", "max-var",    "Number of variables of a state (at least those of every problem).", Hyper_Const::dim1, IntRange(1, Hyper_Const::max_nact / 2));
+static IntOption    opt_size    ("SELFPLAY", "mcts-size",  "Number of MCTS simulations per move.", Hyper_Const::MCTS_size_lim, IntRange(1, INT32_MAX));
+static IntOption    opt_prior   ("SELFPLAY", "prior",      "Evaluation of the leaves (0=uniform, 1=activity, 2=jeroslow-wang, 3=literal count, 4=model).", 2, IntRange(0, 4));
+static StringOption opt_model   ("SELFPLAY", "model",      "The weights of the network of prior 4 (see minisat/core/nn_model.h).");
+static IntOption    opt_batch   ("SELFPLAY", "batch",      "Number of leaves evaluated together.", 1, IntRange(1, INT32_MAX));
+static BoolOption   opt_replay  ("SELFPLAY", "replay",     "Use the replay backend of MCTS instead of shadows.", false);
+static IntOption    opt_sample  ("SELFPLAY", "sample",     "Number of first moves of an episode drawn from the visit counts (the others take the most visited action).", 30, IntRange(0, INT32_MAX));
+static IntOption    opt_seed    ("SELFPLAY", "seed",       "Seed of the moves drawn from the visit counts (episode j draws from seed * 1000003 + j).", 1, IntRange(0, INT32_MAX));
+static IntOption    opt_verb    ("SELFPLAY", "verb",       "Verbosity level (0=silent, 1=some, 2=more).", 1, IntRange(0, 2));
+
+// one episode of the problem of file (the instance-th): the records of its moves are appended to out
+// (-1 for a problem that does not fit the states, e.g. of more than max-var variables: it has no records, and is reported if warn)
+static int episode(const std::string& file, int instance, NNModel* model, int seed, record_writer& out, bool warn) {
+    std::vector<char> name(file.begin(), file.end());
+    name.push_back('\0');
+    GymSolver* g;
+    try { g = new GymSolver(name.data(), opt_clause, opt_var, opt_size); }
+    catch (const std::invalid_argument& e) {
+        if (warn) printf("WARNING! %s: %s (skipped)\n", file.c_str(), e.what());
+        return -1;
+    }
+    g -> use_replay(opt_replay);
+    if (model != NULL) g -> use_model(model);
+
+    int nact   = Hyper_Const::dim2 * opt_var;
+    int packed = g -> packed_size();
+    std::vector<uint8_t> obs(packed), states;
+    std::vector<float>   count(nact), pis;
+    std::mt19937         rng(seed);
+    int moves = 0;
+    bool live = g -> init_packed(obs.data(), packed);
+    while (live && !g -> get_done()) {
+        g -> simulate_native(opt_prior, opt_batch);
+        std::fill(count.begin(), count.end(), 0.0f);
+        g -> get_visit_count(count.data(), nact);
+        float total = 0;
+        for (int a = 0; a < nact; a++) total += count[a];
+        if (total == 0) {                                        // (no simulation was run): all the valid actions, the last column of obs
+            const uint8_t* valid = &obs[opt_clause * state_dims(opt_clause, opt_var).col_bytes()];
+            for (int a = 0; a < nact; a++)
+                if ((valid[a >> 3] >> (a & 7)) & 1) { count[a] = 1; total++; }
+            if (total == 0) printf("ERROR! %s: no valid action in a state that is not done\n", file.c_str()), exit(1);
+        }
+
+        // the record (its value is known at the end of the episode)
+        for (int a = 0; a < nact; a++) count[a] /= total;
+        states.insert(states.end(), obs.begin(), obs.end());
+        pis.insert(pis.end(), count.begin(), count.end());
+
+        int pick = g -> get_proven_action();                     // (the shortest line, once the search has proven it)
+        if (pick < 0 && moves < opt_sample) {
+            double x = std::uniform_real_distribution<double>(0, 1)(rng), sum = 0;
+            for (pick = 0; pick < nact - 1; pick++)
+                if (count[pick] > 0 && (sum += count[pick]) > x) break;
+            while (pick > 0 && count[pick] == 0) pick--;         // (x is past the sum of the counts by rounding)
+        } else if (pick < 0) {
+            pick = 0;
+            for (int a = 1; a < nact; a++)
+                if (count[a] > count[pick]) pick = a;
+        }
+
+        g -> set_decision(pick);
+        std::fill(obs.begin(), obs.end(), 0);
+        g -> step_packed(obs.data(), packed);
+        moves++;
+    }
+    delete g;
+    for (int m = 0; m < moves; m++)
+        out.add(&states[m * packed], &pis[m * nact], (float)(m + 1 - moves), instance, m);
+    const char* error = out.flush();
+    if (error != NULL) printf("ERROR! %s\n", error), exit(1);
+    return moves;
+}
+
+//=================================================================================================
+// Main:
+
+int main(int argc, char** argv)
+{
+    setUsageHelp("USAGE: %s [options] <cnf-directory> <shard-file>\n\n  runs the episodes of the problems of the directory, and appends their moves to the shard.\n");
+    parseOptions(argc, argv, true);
+    if (argc != 3) printf("ERROR! Give a directory of problems and a shard file (see --help)\n"), exit(1);
+
+    std::vector<std::string> files;
+    DIR* dir = opendir(argv[1]);
+    if (dir == NULL) printf("ERROR! Could not open directory: %s\n", argv[1]), exit(1);
+    for (struct dirent* e; (e = readdir(dir)) != NULL; )
+        if (e -> d_name[0] != '.') files.push_back(std::string(argv[1]) + "/" + e -> d_name);
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+
+    NNModel* model = NULL;
+    if (opt_prior == Solver::prior_model) {
+        if (!opt_model) printf("ERROR! Prior 4 needs a model (-model=<file>)\n"), exit(1);
+        try { model = new NNModel((char*)(const char*)opt_model); }
+        catch (const std::invalid_argument& e) { printf("ERROR! %s: %s\n", (const char*)opt_model, e.what()), exit(1); }
+    }
+
+    // the records are appended to the shard (it may hold the records of earlier runs with the same max-clause and max-var),
+    // by one writer for each thread
+    std::vector<record_writer> out(opt_threads);
+    for (int t = 0; t < opt_threads; t++) {
+        const char* error = out[t].open(argv[2], state_dims(opt_clause, opt_var));
+        if (error != NULL) printf("ERROR! %s: %s\n", argv[2], error), exit(1);
+    }
+
+    // the jobs are the episodes, in the order of the files; each thread takes the next one until there are none
+    double start = realTime();
+    int njobs = (int)files.size() * opt_episodes;
+    std::atomic<int> next(0), skipped(0);
+    auto work = [&](int t) {
+        for (int j; (j = next++) < njobs; ) {
+            const std::string& file = files[j / opt_episodes];
+            int moves = episode(file, j / opt_episodes, model, opt_seed * 1000003 + j, out[t], j % opt_episodes == 0);
+            if (moves < 0) skipped++;
+            else if (opt_verb >= 2) printf("%s: episode %d of %d moves\n", file.c_str(), j % opt_episodes, moves);
+        }
+    };
+    std::vector<std::thread> team;
+    for (int t = 1; t < opt_threads; t++) team.push_back(std::thread(work, t));
+    work(0);
+    for (int t = 0; t < (int)team.size(); t++) team[t].join();
+
+    int64_t records = 0;
+    for (int t = 0; t < opt_threads; t++) records += out[t].written();
+    if (opt_verb >= 1)
+        printf("%d episodes of %d problems: %lld records in %.2f s (%d episodes skipped)\n", njobs - skipped, (int)files.size(), (long long)records,
+               realTime() - start, (int)skipped);
+    delete model;
+    return 0;
+}
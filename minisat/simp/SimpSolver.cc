@@ -548,6 +548,31 @@ bool SimpSolver::eliminateVar(Var v)
 }
 
 
+void SimpSolver::copyProblem(const SimpSolver& from)
+{
+    assert(from.subsumption_queue.size() == 0);
+    Solver::copyProblem(from);
+
+    elimorder          = from.elimorder;
+    use_simplification = from.use_simplification;
+    max_simp_var       = from.max_simp_var;
+    bwdsub_assigns     = from.bwdsub_assigns;
+    n_touched          = from.n_touched;
+    bwdsub_tmpunit     = from.bwdsub_tmpunit;
+    merges             = from.merges;
+    asymm_lits         = from.asymm_lits;
+    eliminated_vars    = from.eliminated_vars;
+    from.elimclauses.copyTo(elimclauses);
+    from.touched    .copyTo(touched);
+    from.occurs     .copyTo(occurs);
+    from.n_occ      .copyTo(n_occ);
+    from.elim_heap  .copyTo(elim_heap);
+    from.frozen     .copyTo(frozen);
+    from.frozen_vars.copyTo(frozen_vars);
+    from.eliminated .copyTo(eliminated);
+}
+
+
 bool SimpSolver::substitute(Var v, Lit x)
 {
     assert(!frozen[v]);
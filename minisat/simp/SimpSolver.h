@@ -49,6 +49,7 @@ class SimpSolver : public Solver {
     bool    addClause (Lit p, Lit q, Lit r, Lit s); // Add a quaternary clause to the solver. 
     bool    addClause_(      vec<Lit>& ps);
     bool    substitute(Var v, Lit x);  // Replace all occurences of v with x (may cause a contradiction).
+    void    copyProblem(const SimpSolver& from); // The same as Solver::copyProblem(), with the state of the simplification.
 
     // Variable mode:
     // 
@@ -128,11 +129,6 @@ class SimpSolver : public Solver {
         //     return c_x < c_y || c_x == c_y && x < y; }
     };
 
-    struct ClauseDeleted {
-        const ClauseAllocator& ca;
-        explicit ClauseDeleted(const ClauseAllocator& _ca) : ca(_ca) {}
-        bool operator()(const CRef& cr) const { return ca[cr].mark() == 1; } };
-
     // Solver state:
     //
     int                 elimorder;
@@ -20,9 +20,13 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 #include <signal.h>
 #include <stdio.h>
+#include <chrono>
 
 #include "minisat/utils/System.h"
 
+double Minisat::realTime() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
 #if defined(__linux__)
 
 #include <stdlib.h>
@@ -0,0 +1,346 @@
+/*****************************************************************************************[gym_test.cc]
+Checks of the gym library: the MCTS node pool and the clause arena, the parallel and ensemble searches,
+the training records, and the caches. Run by 'make test' (it exits with the number of failed checks).
+**************************************************************************************************/
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <list>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "minisat/core/SolverTypes.h"
+#include "minisat/core/eval_cache.h"
+#include "minisat/core/node_pool.h"
+#include "minisat/core/replay.h"
+#include "minisat/gym/GymSolver.h"
+#include "minisat/gym/records.h"
+
+using namespace Minisat;
+
+static int failed = 0;
+
+#define check(cond) do { if (!(cond)) { failed++; printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); } } while (0)
+
+// the clauses of a random 3-SAT problem of n variables and m clauses (DIMACS, each clause ended by 0), the same for a seed
+static std::vector<int> random_3sat(int n, int m, int seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> clauses;
+    for (int c = 0; c < m; c++) {
+        for (int k = 0; k < 3; k++) {
+            int v = 1 + (int)(rng() % n);
+            clauses.push_back(rng() % 2 ? v : -v);
+        }
+        clauses.push_back(0);
+    }
+    return clauses;
+}
+
+static GymSolver* new_problem(const std::vector<int>& clauses, int max_var, int mcts_size) {
+    return new GymSolver((int*)clauses.data(), clauses.size(), 200, max_var, mcts_size);
+}
+
+// the most visited action of the MCTS of this move
+static int most_visited(GymSolver& g, int nact, float* sum = NULL) {
+    std::vector<float> count(nact);
+    g.get_visit_count(count.data(), nact);
+    int pick = 0;
+    float total = 0;
+    for (int a = 0; a < nact; a++) {
+        total += count[a];
+        if (count[a] > count[pick]) pick = a;
+    }
+    if (sum != NULL) *sum = total;
+    return pick;
+}
+
+// a whole episode of native MCTS, from the same dirichlet noise each time: the actions taken, in order
+static std::vector<int> episode(const std::vector<int>& clauses, bool replay, int threads, int trees, int batch) {
+    const int max_var = 50, nact = 2 * max_var;
+    GymSolver::seed(1);
+    GymSolver* g = new_problem(clauses, max_var, 60);
+    g -> use_replay(replay);
+    g -> use_threads(threads);
+    g -> use_trees(trees);
+    std::vector<unsigned char> obs(g -> packed_size());
+    std::vector<int> moves;
+    bool live = g -> init_packed(obs.data(), obs.size());
+    while (live && !g -> get_done() && moves.size() < 200) {
+        int sims = g -> simulate_native(Solver::prior_jw, batch);
+        float visits;
+        int pick = most_visited(*g, nact, &visits);
+        check(sims > 0);
+        check(visits > 0);
+        moves.push_back(pick);
+        g -> set_decision(pick);
+        memset(obs.data(), 0, obs.size());
+        g -> step_packed(obs.data(), obs.size());
+    }
+    check(!live || g -> get_done());
+    delete g;
+    return moves;
+}
+
+//=================================================================================================
+
+static void test_node_pool() {
+    const int nact = 40;
+    node_pool<replay> pool;
+    pool.use_tail(replay::tail_bytes(nact));
+    check(pool.node_bytes() >= sizeof(replay) + replay::tail_bytes(nact));
+
+    replay* root = new (pool.alloc()) replay(nact);
+    for (int a = 0; a < nact; a++) {
+        check(root -> childern[a] == NULL && root -> nn[a] == 0 && !root -> valid[a]);
+        root -> childern[a] = new (pool.alloc()) replay(root, a);
+        for (int b = 0; b < nact; b += 7)
+            root -> childern[a].load() -> childern[b] = new (pool.alloc()) replay(root -> childern[a], b);
+    }
+    int nodes = 1 + nact * (1 + (nact + 6) / 7);
+    check(pool.size() == nodes);
+
+    // a subtree handed over is destructed when its slots are needed (or at clear), and its slots are reused
+    int capacity = pool.capacity();
+    replay* kept = root -> next_root(3);
+    pool.discard(root);
+    check(pool.size() == nodes);
+    std::vector<replay*> fresh;
+    for (int i = 0; i < nodes - (1 + (nact + 6) / 7); i++) fresh.push_back(new (pool.alloc()) replay(nact));
+    check(pool.capacity() == capacity);
+    check(kept -> parent == NULL && kept -> childern[0] != NULL);
+    pool.discard(kept);
+    pool.clear();
+    check(pool.size() == (int)fresh.size());
+    for (int i = 0; i < (int)fresh.size(); i++) pool.free(fresh[i]);
+    check(pool.size() == 0);
+}
+
+// a line is proven only when no other child can be shorter (see mcts_node::prove)
+static void test_proof() {
+    const int nact = 4;
+    node_pool<replay> pool;
+    pool.use_tail(replay::tail_bytes(nact));
+    replay* root = new (pool.alloc()) replay(nact);
+    for (int a = 0; a < nact; a++) root -> valid[a] = true;
+    replay* deep = root;                                           // (three steps down action 0, to a node with a finished child)
+    for (int d = 0; d < 3; d++) {
+        replay* child = new (pool.alloc()) replay(deep, 0);
+        for (int a = 0; a < nact; a++) child -> valid[a] = true;
+        deep -> childern[0] = child;
+        deep = child;
+    }
+    deep -> done[1] = true;
+    deep -> prove();
+    check(deep -> proven && deep -> proven_depth == 1 && deep -> proven_action() == 1);
+    replay* above = deep -> parent;                                // (its other childern are not expanded: one may be finished)
+    check(!above -> proven && !root -> proven && root -> proven_action() == -1);
+
+    for (int a = 1; a < nact; a++) above -> childern[a] = new (pool.alloc()) replay(above, a);
+    above -> prove();
+    check(above -> proven && above -> proven_depth == 2 && above -> proven_action() == 0);
+    check(!root -> proven);
+    check(above -> pick_child() != 0);                             // (a proven child is passed over)
+
+    root -> done[2] = true;                                        // a finished child of the root: one step, shorter than the line of action 0
+    root -> prove();
+    check(root -> proven && root -> proven_depth == 1 && root -> proven_action() == 2);
+    pool.discard(root);
+    pool.clear();
+}
+
+static void test_clause_arena() {
+    ClauseArena arena;
+    std::vector<ClauseArena::Chunks> owners(8);
+    vec<Lit> lits;
+    for (int i = 0; i < 300; i++) lits.push(mkLit(i, i % 2));
+
+    for (int round = 0; round < 3; round++) {
+        std::vector<CRef> firsts;
+        for (int o = 0; o < (int)owners.size(); o++)
+            for (int c = 0; c < 50; c++) {
+                vec<Lit> ps;
+                for (int k = 0; k < 3 + (c + o) % 20; k++) ps.push(lits[(c * 7 + k) % 200]);
+                CRef cr = arena.alloc(owners[o], ps);
+                if (c == 0) firsts.push_back(cr);
+                check(arena[cr].size() == ps.size() && arena[cr][0] == ps[0]);
+            }
+        CRef huge = arena.alloc(owners[0], lits);                 // (larger than a chunk: a chunk of its own)
+        check(arena[huge].size() == lits.size() && arena[huge].last() == lits.last());
+        check(!arena[huge].has_count());
+        arena.free(owners[1], firsts[1]);
+        check(arena.wasted() > 0 && arena.size() > arena.wasted());
+        uint64_t held = arena.bytes();
+        check(held >= arena.size() * sizeof(uint32_t));
+
+        for (int o = 0; o < (int)owners.size(); o++) arena.release(owners[o]);
+        check(arena.size() == 0 && arena.wasted() == 0 && arena.bytes() == 0);
+        (void)held;
+    }
+
+    ClauseAllocator from, to;                                      // the Solver's clauses keep their counter when relocated
+    vec<Lit> ps;
+    for (int k = 0; k < 5; k++) ps.push(lits[k]);
+    CRef cr = from.alloc(ps, true);
+    from[cr].satCount() = 3;
+    from[cr].shrink(1);
+    from.reloc(cr, to);
+    check(to[cr].has_count() && to[cr].satCount() == 3 && to[cr].size() == 4 && to[cr].learnt());
+}
+
+//=================================================================================================
+
+static void test_search() {
+    std::vector<int> clauses = random_3sat(50, 213, 1);
+
+    // one tree of one thread is deterministic for a seed of the noise, on either backend
+    std::vector<int> one = episode(clauses, false, 1, 1, 1);
+    check(one.size() > 0);
+    check(episode(clauses, false, 1, 1, 1) == one);
+    check(episode(clauses, false, 1, 1, 8).size() > 0);
+    std::vector<int> replayed = episode(clauses, true, 1, 1, 1);
+    check(replayed.size() > 0);
+    check(episode(clauses, true, 1, 1, 1) == replayed);
+
+    // several threads on one tree, and an ensemble of trees: complete episodes, with visits on every move
+    check(episode(clauses, false, 4, 1, 8).size() > 0);
+    check(episode(clauses, false, 1, 3, 4).size() > 0);
+    check(episode(clauses, false, 4, 3, 8).size() > 0);
+
+    // the evaluations of the caller and of simulate_native do not mix in one move
+    GymSolver* g = new_problem(clauses, 50, 20);
+    std::vector<float> state(g -> state_size()), pi(100, 0.01f), v(1, 0.0f);
+    check(g -> init(state.data(), state.size()));
+    g -> simulate_native(Solver::prior_uniform, 1);
+    bool threw = false;
+    try { g -> simulate(state.data(), state.size(), pi.data(), pi.size(), v.data(), v.size()); }
+    catch (const std::invalid_argument&) { threw = true; }
+    check(threw);
+    delete g;
+
+    // a problem of more variables than max_var is rejected
+    threw = false;
+    try { delete new_problem(random_3sat(60, 200, 2), 50, 20); }
+    catch (const std::invalid_argument&) { threw = true; }
+    check(threw);
+
+    // so is a file that can not be read, or that is UNSAT by simplification (the process goes on)
+    char path[] = "/tmp/gym_test_XXXXXX";
+    int fd = mkstemp(path);
+    check(fd >= 0 && write(fd, "p cnf 1 2\n1 0\n-1 0\n", 19) == 19);
+    close(fd);
+    for (int i = 0; i < 2; i++) {
+        threw = false;
+        try { delete new GymSolver(i == 0 ? path : (char*)"/nonexistent/gym_test.cnf", 200, 50, 20); }
+        catch (const std::invalid_argument&) { threw = true; }
+        check(threw);
+    }
+    unlink(path);
+}
+
+//=================================================================================================
+
+static void test_records() {
+    char path[] = "/tmp/gym_test_XXXXXX";
+    int fd = mkstemp(path);
+    check(fd >= 0);
+    close(fd);
+    unlink(path);
+
+    state_dims dims(30, 10);
+    record_format format(dims);
+    std::vector<uint8_t> packed(dims.packed_size());
+    std::vector<float>   pi(dims.nact());
+    record_writer w1, w2;
+    check(w1.open(path, dims) == NULL);
+    check(w2.open(path, dims) == NULL);
+    for (int i = 0; i < 10; i++) {
+        packed[0] = i; pi[1] = i;
+        (i % 2 ? w1 : w2).add(packed.data(), pi.data(), -i, 7, i);
+    }
+    check(w1.pending() == 5 && w1.flush() == NULL && w2.flush() == NULL);
+    check(w1.written() == 5 && w2.written() == 5);
+
+    record_writer other;
+    check(other.open(path, state_dims(30, 20)) != NULL);            // (the records of the file are of other dims)
+
+    record_reader r;
+    check(r.open(path) == NULL);
+    check(r.size() == 10);
+    int sum = 0;
+    for (int i = 0; i < r.size(); i++) {
+        check(r.packed(i)[0] == r.step(i) && r.pi(i)[1] == r.step(i) && r.value(i) == -(float)r.step(i) && r.instance(i) == 7);
+        sum += r.step(i);
+    }
+    check(sum == 45);
+
+    // a write that fails part way (the file size limit) is cut off, so no part of a record is left
+    struct stat st;
+    stat(path, &st);
+    signal(SIGXFSZ, SIG_IGN);
+    struct rlimit old, limit;
+    getrlimit(RLIMIT_FSIZE, &old);
+    limit = old;
+    limit.rlim_cur = st.st_size + format.record_size() * 3 / 2;
+    setrlimit(RLIMIT_FSIZE, &limit);
+    for (int i = 0; i < 3; i++) w1.add(packed.data(), pi.data(), 0, 8, i);
+    check(w1.flush() != NULL);
+    setrlimit(RLIMIT_FSIZE, &old);
+    struct stat after;
+    stat(path, &after);
+    check(after.st_size == st.st_size);
+    check(r.refresh() == NULL && r.size() == 10);
+
+    r.close();
+    unlink(path);
+}
+
+//=================================================================================================
+
+// the cache of evaluations against a plain LRU list of the same capacity
+static void test_eval_cache() {
+    for (int cap = 1; cap <= 64; cap *= 4) {
+        eval_cache cache(cap);
+        std::list<uint64_t> order;
+        std::map<uint64_t, float> want;
+        std::mt19937_64 rng(cap);
+        for (int i = 0; i < 20000; i++) {
+            uint64_t key = rng() % (3 * cap + 1);
+            if (rng() % 4 == 0) key <<= 32;                           // (keys of the same home slot)
+            float pi[4], v;
+            if (rng() % 2) {
+                bool hit = cache.lookup(key, 4, pi, v);
+                check(hit == (want.count(key) > 0));
+                if (hit) {
+                    check(v == want[key] && pi[3] == want[key] + 3);
+                    order.remove(key); order.push_front(key);
+                }
+            } else {
+                float x = i % 1000, p[4] = { x, x + 1, x + 2, x + 3 };
+                cache.insert(key, 4, p, x);
+                if (want.count(key)) order.remove(key);
+                else if ((int)want.size() == cap) { want.erase(order.back()); order.pop_back(); }
+                order.push_front(key);
+                want[key] = x;
+            }
+            check(cache.size() == (int)want.size());
+        }
+    }
+}
+
+int main() {
+    test_node_pool();
+    test_proof();
+    test_clause_arena();
+    test_search();
+    test_records();
+    test_eval_cache();
+    if (failed == 0) printf("all checks passed\n");
+    return failed;
+}
@@ -0,0 +1,133 @@
+"""
+Smoke test of the gym API (minisat/gym/MiniSATEnv.py): run by 'make python-test', from the root of the repository, once the
+SWIG wrapper is built (make python-wrap)
+"""
+import os
+import sys
+import tempfile
+import unittest
+
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+from minisat.gym.MiniSATEnv import gym_sat_Env  # noqa: E402
+
+
+def random_3sat(n, m, seed):
+    """
+    The clauses of a random 3-SAT problem of n variables and m clauses, as the int32 array of reset_with
+    """
+    rng = np.random.RandomState(seed)
+    lits = rng.randint(1, n + 1, size=(m, 3)) * rng.choice([-1, 1], size=(m, 3))
+    return np.hstack([lits, np.zeros((m, 1), dtype=lits.dtype)]).astype(np.int32).ravel()
+
+
+class GymTest(unittest.TestCase):
+    max_var = 20
+
+    @classmethod
+    def setUpClass(cls):
+        cls.dir = tempfile.TemporaryDirectory()
+        with open(os.path.join(cls.dir.name, "p.cnf"), "w") as f:
+            clauses = random_3sat(cls.max_var, 85, 1).reshape(-1, 4)
+            f.write("p cnf {} {}\n".format(cls.max_var, len(clauses)))
+            for c in clauses:
+                f.write(" ".join(str(x) for x in c) + "\n")
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.dir.cleanup()
+
+    def env(self, **kwargs):
+        return gym_sat_Env(self.dir.name, max_clause=100, max_var=self.max_var, mcts_size=30, **kwargs)
+
+    def play(self, env, state, search):
+        """
+        Play an episode from state: search(env) runs the MCTS of a move, the move is the most visited action
+        :returns: the number of moves
+        """
+        moves = 0
+        done = state is None
+        while not done:
+            search(env)
+            count = env.get_visit_count()
+            self.assertEqual(count.shape, (env.action_space,))
+            self.assertGreater(count.sum(), 0)
+            done, state = env.step(int(np.argmax(count)))
+            moves += 1
+            self.assertLess(moves, 2 * self.max_var + 1)
+        return moves
+
+    def test_simulate(self):
+        def search(env):
+            pi, v = np.full(env.action_space, 1.0 / env.action_space, dtype=np.float32), 0.0
+            while True:
+                state, evaluate, more = env.simulate(pi, v)
+                if not evaluate and not more:
+                    break
+        env = self.env()
+        state = env.reset()
+        self.assertEqual(state.shape, (100, self.max_var, 2))
+        self.assertGreater(self.play(env, state, search), 0)
+
+    def test_simulate_batch(self):
+        def search(env):
+            pi = np.zeros((0, env.action_space), dtype=np.float32)
+            v = np.zeros(0, dtype=np.float32)
+            while True:
+                states, more = env.simulate_batch(pi, v, 4)
+                if len(states) == 0 and not more:
+                    break
+                pi = np.full((len(states), env.action_space), 1.0 / env.action_space, dtype=np.float32)
+                v = np.zeros(len(states), dtype=np.float32)
+        for kwargs in ({}, {"mcts_threads": 2}, {"mcts_trees": 2}):
+            env = self.env(**kwargs)
+            self.assertGreater(self.play(env, env.reset_with(random_3sat(self.max_var, 85, 2)), search), 0)
+
+    def test_simulate_native(self):
+        for kwargs in ({}, {"mcts": "replay"}, {"obs": "packed", "mcts_trees": 2}):
+            env = self.env(**kwargs)
+            state = env.reset_with(random_3sat(self.max_var, 85, 3))
+            self.play(env, state, lambda env: self.assertGreater(env.simulate_native("jw", 2), 0))
+
+    def test_seed(self):
+        moves = []
+        for _ in range(2):
+            env = self.env()
+            env.seed(7)
+            state = env.reset_with(random_3sat(self.max_var, 85, 6))
+            actions = []
+            done = state is None
+            while not done:
+                env.simulate_native("jw")
+                actions.append(int(np.argmax(env.get_visit_count())))
+                done, state = env.step(actions[-1])
+            moves.append(actions)
+        self.assertEqual(moves[0], moves[1])
+
+    def test_packed(self):
+        env = self.env(obs="packed")
+        packed = env.reset_with(random_3sat(self.max_var, 85, 4))
+        self.assertEqual(packed.dtype, np.uint8)
+        unpacked, valid = env.unpack_state(packed)
+        env = self.env()
+        state = env.reset_with(random_3sat(self.max_var, 85, 4))
+        self.assertTrue(np.array_equal(unpacked, state[:len(unpacked)]))
+        self.assertTrue(valid.any())
+
+    def test_mixing(self):
+        env = self.env()
+        env.reset_with(random_3sat(self.max_var, 85, 5))
+        env.simulate_native("uniform")
+        with self.assertRaises(ValueError):
+            env.simulate(np.zeros(env.action_space, dtype=np.float32), 0.0)
+
+    def test_out_of_range(self):
+        env = self.env()
+        with self.assertRaises(ValueError):
+            env.reset_with(np.array([1, self.max_var + 1, 0], dtype=np.int32))
+
+
+if __name__ == "__main__":
+    unittest.main()